@@ -0,0 +1,207 @@
+#include "big_decimal.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+BigDecimal::BigDecimal() : unscaled_(0), scale_(0) {}
+
+BigDecimal::BigDecimal(int64_t num) : unscaled_(num), scale_(0) {}
+
+BigDecimal::BigDecimal(const BigInt& unscaled, size_t scale)
+    : unscaled_(unscaled), scale_(scale) {}
+
+BigDecimal::BigDecimal(const std::string& str) : BigDecimal() {
+  size_t point = str.find('.');
+  if (point == std::string::npos) {
+    unscaled_ = BigInt(str);
+    return;
+  }
+  std::string digits = str.substr(0, point) + str.substr(point + 1);
+  scale_ = str.size() - point - 1;
+  // BigInt wants no leading zeros.
+  size_t sign = !digits.empty() && digits[0] == '-' ? 1 : 0;
+  size_t first = digits.find_first_not_of('0', sign);
+  if (first == std::string::npos) {
+    unscaled_ = BigInt(0);
+    return;
+  }
+  unscaled_ = BigInt(digits.substr(0, sign) + digits.substr(first));
+}
+
+bool operator==(const BigDecimal& left, const BigDecimal& right) {
+  if (left.scale_ == right.scale_) {
+    return left.unscaled_ == right.unscaled_;
+  }
+  BigDecimal first = left;
+  BigDecimal second = right;
+  first.Widen(right.scale_);
+  second.Widen(left.scale_);
+  return first.unscaled_ == second.unscaled_;
+}
+
+bool operator!=(const BigDecimal& left, const BigDecimal& right) {
+  return !(left == right);
+}
+
+bool BigDecimal::operator<(const BigDecimal& other) const {
+  if (scale_ == other.scale_) {
+    return unscaled_ < other.unscaled_;
+  }
+  BigDecimal first = *this;
+  BigDecimal second = other;
+  first.Widen(other.scale_);
+  second.Widen(scale_);
+  return first.unscaled_ < second.unscaled_;
+}
+
+bool BigDecimal::operator>(const BigDecimal& other) const {
+  return other < *this;
+}
+bool BigDecimal::operator<=(const BigDecimal& other) const {
+  return !(other < *this);
+}
+bool BigDecimal::operator>=(const BigDecimal& other) const {
+  return !(*this < other);
+}
+
+BigDecimal BigDecimal::operator-() const {
+  return BigDecimal(-unscaled_, scale_);
+}
+
+BigDecimal& BigDecimal::operator+=(const BigDecimal& other) {
+  Widen(other.scale_);
+  if (scale_ == other.scale_) {
+    unscaled_ += other.unscaled_;
+    return *this;
+  }
+  unscaled_ += other.unscaled_ * Pow10(scale_ - other.scale_);
+  return *this;
+}
+
+BigDecimal& BigDecimal::operator-=(const BigDecimal& other) {
+  return *this += -other;
+}
+
+BigDecimal& BigDecimal::operator*=(const BigDecimal& other) {
+  size_t scale = std::max(scale_, other.scale_);
+  // The exact product has scale_ + other.scale_ digits after the point.
+  unscaled_ = DivideRounded(unscaled_ * other.unscaled_,
+                            Pow10(scale_ + other.scale_ - scale));
+  scale_ = scale;
+  return *this;
+}
+
+BigDecimal& BigDecimal::operator/=(const BigDecimal& other) {
+  if (other.unscaled_ == 0) {
+    throw std::invalid_argument("Division by zero");
+  }
+  size_t scale = std::max(scale_, other.scale_);
+  // (a / 10^s) / (b / 10^t) * 10^scale = a * 10^(scale + t - s) / b.
+  BigInt numerator = unscaled_ * Pow10(scale + other.scale_ - scale_);
+  BigInt denominator = other.unscaled_;
+  if (denominator < 0) {
+    numerator = -numerator;
+    denominator = -denominator;
+  }
+  unscaled_ = DivideRounded(numerator, denominator);
+  scale_ = scale;
+  return *this;
+}
+
+BigDecimal operator+(const BigDecimal& left, const BigDecimal& right) {
+  BigDecimal result = left;
+  result += right;
+  return result;
+}
+
+BigDecimal operator-(const BigDecimal& left, const BigDecimal& right) {
+  BigDecimal result = left;
+  result -= right;
+  return result;
+}
+
+BigDecimal operator*(const BigDecimal& left, const BigDecimal& right) {
+  BigDecimal result = left;
+  result *= right;
+  return result;
+}
+
+BigDecimal operator/(const BigDecimal& left, const BigDecimal& right) {
+  BigDecimal result = left;
+  result /= right;
+  return result;
+}
+
+const BigInt& BigDecimal::Unscaled() const { return unscaled_; }
+
+size_t BigDecimal::Scale() const { return scale_; }
+
+BigDecimal BigDecimal::Rescale(size_t scale) const {
+  if (scale >= scale_) {
+    BigDecimal result = *this;
+    result.Widen(scale);
+    return result;
+  }
+  return BigDecimal(DivideRounded(unscaled_, Pow10(scale_ - scale)), scale);
+}
+
+BigRational BigDecimal::ToRational() const {
+  return BigRational(unscaled_, Pow10(scale_));
+}
+
+std::ostream& operator<<(std::ostream& ost, const BigDecimal& out) {
+  if (out.scale_ == 0) {
+    return ost << out.unscaled_;
+  }
+  bool negative = out.unscaled_ < 0;
+  std::string digits;
+  {
+    std::ostringstream stream;
+    stream << (negative ? -out.unscaled_ : out.unscaled_);
+    digits = stream.str();
+  }
+  if (digits.size() <= out.scale_) {
+    digits.insert(0, out.scale_ - digits.size() + 1, '0');
+  }
+  digits.insert(digits.size() - out.scale_, 1, '.');
+  if (negative) {
+    ost << '-';
+  }
+  return ost << digits;
+}
+
+std::istream& operator>>(std::istream& ist, BigDecimal& inside) {
+  std::string temp;
+  ist >> temp;
+  inside = BigDecimal(temp);
+  return ist;
+}
+
+BigInt BigDecimal::Pow10(size_t exponent) {
+  return BigInt("1" + std::string(exponent, '0'));
+}
+
+BigInt BigDecimal::DivideRounded(const BigInt& numerator,
+                                 const BigInt& denominator) {
+  if (denominator == 1) {
+    return numerator;
+  }
+  BigInt quotient = numerator / denominator;
+  BigInt twice_rest = (numerator - quotient * denominator) * 2;
+  if (twice_rest < 0) {
+    twice_rest = -twice_rest;
+  }
+  if (twice_rest > denominator ||
+      (twice_rest == denominator && quotient % 2 != 0)) {
+    quotient += numerator < 0 ? -1 : 1;
+  }
+  return quotient;
+}
+
+void BigDecimal::Widen(size_t scale) {
+  if (scale > scale_) {
+    unscaled_ *= Pow10(scale - scale_);
+    scale_ = scale;
+  }
+}
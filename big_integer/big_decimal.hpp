@@ -0,0 +1,57 @@
+#pragma once
+#include <iostream>
+#include <string>
+
+#include "big_integer.hpp"
+#include "big_rational.hpp"
+
+// Fixed-point decimal: a BigInt count of units of 10^-scale. Sums and
+// differences are exact and take the larger scale of the operands, so adding
+// values of one scale is a single BigInt addition. Products and quotients
+// are rounded half to even back to that scale.
+class BigDecimal {
+ public:
+  BigDecimal();
+  BigDecimal(int64_t);
+  BigDecimal(const BigInt& unscaled, size_t scale);
+  // "-12.345" has scale 3.
+  BigDecimal(const std::string&);
+
+  friend bool operator==(const BigDecimal&, const BigDecimal&);
+  friend bool operator!=(const BigDecimal&, const BigDecimal&);
+  bool operator<(const BigDecimal&) const;
+  bool operator>(const BigDecimal&) const;
+  bool operator<=(const BigDecimal&) const;
+  bool operator>=(const BigDecimal&) const;
+
+  BigDecimal operator-() const;
+  BigDecimal& operator+=(const BigDecimal&);
+  BigDecimal& operator-=(const BigDecimal&);
+  BigDecimal& operator*=(const BigDecimal&);
+  BigDecimal& operator/=(const BigDecimal&);
+
+  friend BigDecimal operator+(const BigDecimal&, const BigDecimal&);
+  friend BigDecimal operator-(const BigDecimal&, const BigDecimal&);
+  friend BigDecimal operator*(const BigDecimal&, const BigDecimal&);
+  friend BigDecimal operator/(const BigDecimal&, const BigDecimal&);
+
+  const BigInt& Unscaled() const;
+  size_t Scale() const;
+  // Same value at another scale, rounded half to even when digits are lost.
+  BigDecimal Rescale(size_t scale) const;
+  BigRational ToRational() const;
+
+  friend std::ostream& operator<<(std::ostream&, const BigDecimal&);
+  friend std::istream& operator>>(std::istream&, BigDecimal&);
+
+ private:
+  static BigInt Pow10(size_t exponent);
+  // numerator / denominator rounded half to even; denominator is positive.
+  static BigInt DivideRounded(const BigInt& numerator,
+                              const BigInt& denominator);
+
+  void Widen(size_t scale);
+
+  BigInt unscaled_;
+  size_t scale_;
+};
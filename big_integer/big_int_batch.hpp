@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "big_integer.hpp"
+#include "fixed_big_integer.hpp"
+
+// Many independent FixedBigInt<Bits> values stored column-wise: limb i of
+// every value sits in one contiguous array. The arithmetic kernels run the
+// same step on all lanes in plain loops without branches, which compilers
+// vectorize, instead of walking one number at a time. Lanes wrap modulo
+// 2^Bits exactly like FixedBigInt.
+//
+//   BigIntBatch<128> balances, deltas;
+//   ...
+//   balances += deltas;
+//   std::vector<uint8_t> overdrawn = balances.Less(BigIntBatch<128>(n));
+template <size_t Bits>
+class BigIntBatch {
+ public:
+  using Value = FixedBigInt<Bits>;
+  static constexpr size_t kLimbs = Value::kLimbs;
+
+  BigIntBatch() = default;
+  // count zeros.
+  explicit BigIntBatch(size_t count) { resize(count); }
+
+  size_t size() const { return columns_[0].size(); }
+  bool empty() const { return size() == 0; }
+
+  void reserve(size_t count) {
+    for (std::vector<uint32_t>& column : columns_) {
+      column.reserve(count);
+    }
+  }
+
+  void resize(size_t count) {
+    for (std::vector<uint32_t>& column : columns_) {
+      column.resize(count, 0);
+    }
+  }
+
+  void push_back(const Value& value) {
+    for (size_t limb = 0; limb < kLimbs; ++limb) {
+      columns_[limb].push_back(value.GetLimbs()[limb]);
+    }
+  }
+
+  // Throws std::out_of_range if value does not fit into Bits.
+  void push_back(const BigInt& value) { push_back(Value(value)); }
+
+  Value Get(size_t lane) const {
+    typename Value::Limbs limbs{};
+    for (size_t limb = 0; limb < kLimbs; ++limb) {
+      limbs[limb] = columns_[limb][lane];
+    }
+    return Value::FromLimbs(limbs);
+  }
+
+  void Set(size_t lane, const Value& value) {
+    for (size_t limb = 0; limb < kLimbs; ++limb) {
+      columns_[limb][lane] = value.GetLimbs()[limb];
+    }
+  }
+
+  BigInt ToBigInt(size_t lane) const { return Get(lane).ToBigInt(); }
+
+  BigIntBatch& operator+=(const BigIntBatch& other) {
+    CheckSize(other);
+    ForEachBlock([&](size_t begin, size_t count) {
+      uint32_t carry[kBlock] = {};
+      for (size_t limb = 0; limb < kLimbs; ++limb) {
+        uint32_t* column = columns_[limb].data() + begin;
+        const uint32_t* addend = other.columns_[limb].data() + begin;
+        for (size_t lane = 0; lane < count; ++lane) {
+          uint64_t sum = uint64_t(column[lane]) + addend[lane] + carry[lane];
+          column[lane] = static_cast<uint32_t>(sum);
+          carry[lane] = static_cast<uint32_t>(sum >> 32);
+        }
+      }
+    });
+    return *this;
+  }
+
+  BigIntBatch& operator-=(const BigIntBatch& other) {
+    CheckSize(other);
+    ForEachBlock([&](size_t begin, size_t count) {
+      uint32_t borrow[kBlock] = {};
+      for (size_t limb = 0; limb < kLimbs; ++limb) {
+        uint32_t* column = columns_[limb].data() + begin;
+        const uint32_t* subtrahend = other.columns_[limb].data() + begin;
+        for (size_t lane = 0; lane < count; ++lane) {
+          uint64_t diff =
+              uint64_t(column[lane]) - subtrahend[lane] - borrow[lane];
+          column[lane] = static_cast<uint32_t>(diff);
+          borrow[lane] = static_cast<uint32_t>(diff >> 63);
+        }
+      }
+    });
+    return *this;
+  }
+
+  // Multiplies every lane by the same factor.
+  BigIntBatch& operator*=(const Value& factor) {
+    const typename Value::Limbs& digits = factor.GetLimbs();
+    ForEachBlock([&](size_t begin, size_t count) {
+      uint32_t product[kLimbs][kBlock] = {};
+      uint32_t carry[kBlock];
+      for (size_t limb = 0; limb < kLimbs; ++limb) {
+        const uint32_t* column = columns_[limb].data() + begin;
+        std::fill(carry, carry + count, 0);
+        for (size_t digit = 0; digit + limb < kLimbs; ++digit) {
+          uint32_t* target = product[limb + digit];
+          for (size_t lane = 0; lane < count; ++lane) {
+            uint64_t cur = uint64_t(column[lane]) * digits[digit] +
+                           target[lane] + carry[lane];
+            target[lane] = static_cast<uint32_t>(cur);
+            carry[lane] = static_cast<uint32_t>(cur >> 32);
+          }
+        }
+      }
+      for (size_t limb = 0; limb < kLimbs; ++limb) {
+        std::copy(product[limb], product[limb] + count,
+                  columns_[limb].data() + begin);
+      }
+    });
+    return *this;
+  }
+
+  void Negate() {
+    ForEachBlock([&](size_t begin, size_t count) {
+      uint32_t carry[kBlock];
+      std::fill(carry, carry + count, 1);
+      for (size_t limb = 0; limb < kLimbs; ++limb) {
+        uint32_t* column = columns_[limb].data() + begin;
+        for (size_t lane = 0; lane < count; ++lane) {
+          uint64_t sum = uint64_t(~column[lane]) + carry[lane];
+          column[lane] = static_cast<uint32_t>(sum);
+          carry[lane] = static_cast<uint32_t>(sum >> 32);
+        }
+      }
+    });
+  }
+
+  // One byte per lane, 1 where this lane is smaller than the other's.
+  std::vector<uint8_t> Less(const BigIntBatch& other) const {
+    CheckSize(other);
+    std::vector<uint8_t> result(size());
+    ForEachBlock([&](size_t begin, size_t count) {
+      uint8_t decided[kBlock] = {};
+      uint8_t* less = result.data() + begin;
+      // From the top limb down; flipping the sign bit of the top limb turns
+      // the signed comparison into an unsigned one.
+      for (size_t limb = kLimbs; limb-- > 0;) {
+        uint32_t flip = limb == kLimbs - 1 ? uint32_t(1) << 31 : 0;
+        const uint32_t* left = columns_[limb].data() + begin;
+        const uint32_t* right = other.columns_[limb].data() + begin;
+        for (size_t lane = 0; lane < count; ++lane) {
+          uint32_t first = left[lane] ^ flip;
+          uint32_t second = right[lane] ^ flip;
+          uint8_t below = first < second;
+          uint8_t above = first > second;
+          less[lane] |= below & ~decided[lane];
+          decided[lane] |= below | above;
+        }
+      }
+    });
+    return result;
+  }
+
+  // One byte per lane, 1 where the lanes are equal.
+  std::vector<uint8_t> Equal(const BigIntBatch& other) const {
+    CheckSize(other);
+    std::vector<uint8_t> result(size(), 1);
+    for (size_t limb = 0; limb < kLimbs; ++limb) {
+      const uint32_t* left = columns_[limb].data();
+      const uint32_t* right = other.columns_[limb].data();
+      for (size_t lane = 0; lane < result.size(); ++lane) {
+        result[lane] &= left[lane] == right[lane];
+      }
+    }
+    return result;
+  }
+
+ private:
+  // Lanes processed together, so that the per-lane carries stay on the
+  // stack and all columns of a block stay in cache.
+  static constexpr size_t kBlock = 256;
+
+  void CheckSize(const BigIntBatch& other) const {
+    if (other.size() != size()) {
+      throw std::invalid_argument("batch sizes differ");
+    }
+  }
+
+  template <typename Kernel>
+  void ForEachBlock(Kernel kernel) const {
+    for (size_t begin = 0; begin < size(); begin += kBlock) {
+      kernel(begin, std::min(kBlock, size() - begin));
+    }
+  }
+
+  std::array<std::vector<uint32_t>, kLimbs> columns_;
+};
@@ -80,6 +80,7 @@ bool BigInt::operator<=(const BigInt& other) const { return !(*this > other); }
 BigInt& BigInt::operator=(const BigInt& other) {
   number_ = other.number_;
   is_negative_ = other.is_negative_;
+  is_null_ = other.is_null_;
   return *this;
 }
 
@@ -129,7 +130,8 @@ BigInt operator*(const BigInt& left, const BigInt& right) {
 
 BigInt BigInt::operator*=(const BigInt& other) {
   if (is_null_ || other.is_null_) {
-    return {0};
+    *this = BigInt(0);
+    return *this;
   }
   std::vector<int> res(this->number_.size() + other.number_.size(), 0);
   for (size_t i = 0; i < this->number_.size(); ++i) {
@@ -242,6 +244,10 @@ std::istream& operator>>(std::istream& ist, BigInt& inside) {
   return ist;
 }
 
+size_t BigInt::DigitCount() const {
+  return number_.empty() ? 1 : number_.size();
+}
+
 BigInt& BigInt::GeneralDiv(const BigInt& other) {
   is_negative_ = (other.is_negative_ != is_negative_);
   BigInt result = BigInt(0);
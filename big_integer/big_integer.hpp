@@ -1,3 +1,4 @@
+#pragma once
 #include <algorithm>
 #include <iostream>
 #include <string>
@@ -36,6 +37,9 @@ class BigInt {
   BigInt operator--();
   BigInt operator--(int);
 
+  // Number of decimal digits, 1 for zero.
+  size_t DigitCount() const;
+
   BigInt& GeneralDiv(const BigInt&);
   BigInt& DeleteZeros();
   BigInt& OneSignPlus(const BigInt&);
@@ -0,0 +1,229 @@
+#include "big_rational.hpp"
+
+#include <stdexcept>
+
+BigRational::BigRational() : numerator_(0), denominator_(1) {}
+
+BigRational::BigRational(int64_t num) : numerator_(num), denominator_(1) {}
+
+BigRational::BigRational(const BigInt& num) : numerator_(num), denominator_(1) {}
+
+BigRational::BigRational(const BigInt& numerator, const BigInt& denominator)
+    : numerator_(numerator), denominator_(denominator) {
+  if (denominator_ == 0) {
+    throw std::invalid_argument("Division by zero");
+  }
+  if (denominator_ < 0) {
+    numerator_ = -numerator_;
+    denominator_ = -denominator_;
+  }
+  MaybeNormalize();
+}
+
+BigRational::BigRational(const std::string& str) : BigRational() {
+  size_t slash = str.find('/');
+  if (slash == std::string::npos) {
+    numerator_ = BigInt(str);
+    return;
+  }
+  *this = BigRational(BigInt(str.substr(0, slash)),
+                      BigInt(str.substr(slash + 1)));
+}
+
+// Denominators are positive, so cross-multiplying keeps the order.
+bool operator==(const BigRational& left, const BigRational& right) {
+  if (left.denominator_ == right.denominator_) {
+    return left.numerator_ == right.numerator_;
+  }
+  return left.numerator_ * right.denominator_ ==
+         right.numerator_ * left.denominator_;
+}
+
+bool operator!=(const BigRational& left, const BigRational& right) {
+  return !(left == right);
+}
+
+bool BigRational::operator<(const BigRational& other) const {
+  if (denominator_ == other.denominator_) {
+    return numerator_ < other.numerator_;
+  }
+  return numerator_ * other.denominator_ < other.numerator_ * denominator_;
+}
+
+bool BigRational::operator>(const BigRational& other) const {
+  return other < *this;
+}
+bool BigRational::operator<=(const BigRational& other) const {
+  return !(other < *this);
+}
+bool BigRational::operator>=(const BigRational& other) const {
+  return !(*this < other);
+}
+
+BigRational BigRational::operator-() const {
+  BigRational result = *this;
+  result.numerator_ = -result.numerator_;
+  return result;
+}
+
+BigRational& BigRational::operator+=(const BigRational& other) {
+  if (denominator_ == other.denominator_) {
+    numerator_ += other.numerator_;
+    return *this;
+  }
+  if (other.denominator_ == 1) {
+    numerator_ += other.numerator_ * denominator_;
+    return *this;
+  }
+  numerator_ = numerator_ * other.denominator_ +
+               other.numerator_ * denominator_;
+  denominator_ *= other.denominator_;
+  MaybeNormalize();
+  return *this;
+}
+
+BigRational& BigRational::operator-=(const BigRational& other) {
+  return *this += -other;
+}
+
+BigRational& BigRational::operator*=(const BigRational& other) {
+  numerator_ *= other.numerator_;
+  if (other.denominator_ != 1) {
+    denominator_ *= other.denominator_;
+    MaybeNormalize();
+  }
+  return *this;
+}
+
+BigRational& BigRational::operator/=(const BigRational& other) {
+  if (other.numerator_ == 0) {
+    throw std::invalid_argument("Division by zero");
+  }
+  numerator_ *= other.denominator_;
+  denominator_ *= other.numerator_;
+  if (denominator_ < 0) {
+    numerator_ = -numerator_;
+    denominator_ = -denominator_;
+  }
+  MaybeNormalize();
+  return *this;
+}
+
+BigRational operator+(const BigRational& left, const BigRational& right) {
+  BigRational result = left;
+  result += right;
+  return result;
+}
+
+BigRational operator-(const BigRational& left, const BigRational& right) {
+  BigRational result = left;
+  result -= right;
+  return result;
+}
+
+BigRational operator*(const BigRational& left, const BigRational& right) {
+  BigRational result = left;
+  result *= right;
+  return result;
+}
+
+BigRational operator/(const BigRational& left, const BigRational& right) {
+  BigRational result = left;
+  result /= right;
+  return result;
+}
+
+BigRational& BigRational::operator++() {
+  numerator_ += denominator_;
+  return *this;
+}
+
+BigRational BigRational::operator++(int) {
+  BigRational result = *this;
+  ++(*this);
+  return result;
+}
+
+BigRational& BigRational::operator--() {
+  numerator_ -= denominator_;
+  return *this;
+}
+
+BigRational BigRational::operator--(int) {
+  BigRational result = *this;
+  --(*this);
+  return result;
+}
+
+BigInt BigRational::Numerator() const {
+  if (denominator_ == 1) {
+    return numerator_;
+  }
+  return Normalized().numerator_;
+}
+
+BigInt BigRational::Denominator() const {
+  if (denominator_ == 1) {
+    return denominator_;
+  }
+  return Normalized().denominator_;
+}
+
+BigInt BigRational::Truncate() const {
+  if (denominator_ == 1) {
+    return numerator_;
+  }
+  return numerator_ / denominator_;
+}
+
+BigRational& BigRational::Normalize() {
+  if (denominator_ != 1) {
+    BigInt gcd = Gcd(numerator_, denominator_);
+    if (gcd != 1) {
+      numerator_ /= gcd;
+      denominator_ /= gcd;
+    }
+  }
+  reduced_digits_ = denominator_.DigitCount();
+  return *this;
+}
+
+BigRational BigRational::Normalized() const {
+  BigRational result = *this;
+  result.Normalize();
+  return result;
+}
+
+std::ostream& operator<<(std::ostream& ost, const BigRational& out) {
+  BigRational reduced = out.Normalized();
+  ost << reduced.numerator_;
+  if (reduced.denominator_ != 1) {
+    ost << '/' << reduced.denominator_;
+  }
+  return ost;
+}
+
+std::istream& operator>>(std::istream& ist, BigRational& inside) {
+  std::string temp;
+  ist >> temp;
+  inside = BigRational(temp);
+  return ist;
+}
+
+BigInt BigRational::Gcd(BigInt first, BigInt second) {
+  if (first < 0) {
+    first = -first;
+  }
+  while (second != 0) {
+    BigInt rest = first % second;
+    first = second;
+    second = rest;
+  }
+  return first;
+}
+
+void BigRational::MaybeNormalize() {
+  if (denominator_.DigitCount() > 2 * reduced_digits_) {
+    Normalize();
+  }
+}
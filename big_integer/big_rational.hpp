@@ -0,0 +1,67 @@
+#pragma once
+#include <iostream>
+#include <string>
+
+#include "big_integer.hpp"
+
+// Exact fraction of two BigInts. The fraction is reduced lazily: arithmetic
+// only keeps the denominator positive, and the GCD is taken once the
+// denominator has grown to twice the digits it had after the last reduction,
+// or when Normalize() is called. Const members never modify the object, so
+// they reduce a copy instead. Adding fractions with equal denominators, e.g.
+// a running sum of integers, never divides at all.
+class BigRational {
+ public:
+  BigRational();
+  BigRational(int64_t);
+  BigRational(const BigInt&);
+  BigRational(const BigInt& numerator, const BigInt& denominator);
+  // "a" or "a/b".
+  BigRational(const std::string&);
+
+  friend bool operator==(const BigRational&, const BigRational&);
+  friend bool operator!=(const BigRational&, const BigRational&);
+  bool operator<(const BigRational&) const;
+  bool operator>(const BigRational&) const;
+  bool operator<=(const BigRational&) const;
+  bool operator>=(const BigRational&) const;
+
+  BigRational operator-() const;
+  BigRational& operator+=(const BigRational&);
+  BigRational& operator-=(const BigRational&);
+  BigRational& operator*=(const BigRational&);
+  BigRational& operator/=(const BigRational&);
+
+  friend BigRational operator+(const BigRational&, const BigRational&);
+  friend BigRational operator-(const BigRational&, const BigRational&);
+  friend BigRational operator*(const BigRational&, const BigRational&);
+  friend BigRational operator/(const BigRational&, const BigRational&);
+
+  BigRational& operator++();
+  BigRational operator++(int);
+  BigRational& operator--();
+  BigRational operator--(int);
+
+  // Parts of the reduced fraction; the denominator is positive. Call
+  // Normalize() first to spare each of them a GCD.
+  BigInt Numerator() const;
+  BigInt Denominator() const;
+  // Quotient truncated towards zero.
+  BigInt Truncate() const;
+
+  // Reduces the fraction in place.
+  BigRational& Normalize();
+  BigRational Normalized() const;
+
+  friend std::ostream& operator<<(std::ostream&, const BigRational&);
+  friend std::istream& operator>>(std::istream&, BigRational&);
+
+ private:
+  static BigInt Gcd(BigInt first, BigInt second);
+
+  void MaybeNormalize();
+
+  BigInt numerator_;
+  BigInt denominator_;
+  size_t reduced_digits_ = 1;
+};
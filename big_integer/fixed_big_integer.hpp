@@ -0,0 +1,422 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "big_integer.hpp"
+
+// Signed Bits-wide integer in two's complement, kept in place as 32-bit
+// limbs (least significant first), so it never allocates and everything but
+// the string conversions is constexpr. Arithmetic wraps modulo 2^Bits like
+// the built-in integers; division truncates towards zero and the remainder
+// takes the sign of the dividend, as with BigInt.
+//
+//   constexpr FixedBigInt<256> kModulus = (FixedBigInt<256>(1) << 255) - 19;
+template <size_t Bits>
+class FixedBigInt {
+  static_assert(Bits > 0 && Bits % 32 == 0, "Bits must be a multiple of 32");
+
+ public:
+  static constexpr size_t kLimbs = Bits / 32;
+  using Limbs = std::array<uint32_t, kLimbs>;
+
+  constexpr FixedBigInt() = default;
+
+  constexpr FixedBigInt(int64_t num) {
+    uint64_t bits = static_cast<uint64_t>(num);
+    uint32_t fill = num < 0 ? ~uint32_t(0) : 0;
+    for (size_t i = 0; i < kLimbs; ++i) {
+      limbs_[i] = i < 2 ? static_cast<uint32_t>(bits >> (32 * i)) : fill;
+    }
+  }
+
+  // Decimal, with an optional leading '-'. Throws std::invalid_argument if
+  // there are no digits or a character is not a digit, and
+  // std::out_of_range if the value does not fit.
+  explicit FixedBigInt(const std::string& str) {
+    size_t pos = !str.empty() && str[0] == '-' ? 1 : 0;
+    bool negative = pos == 1;
+    if (pos == str.size()) {
+      throw std::invalid_argument("not a decimal number");
+    }
+    uint32_t carry = 0;
+    for (; pos < str.size(); ++pos) {
+      if (str[pos] < '0' || str[pos] > '9') {
+        throw std::invalid_argument("not a decimal number");
+      }
+      carry |= MultiplyAdd(10, static_cast<uint32_t>(str[pos] - '0'));
+    }
+    // The magnitude may reach 2^(Bits - 1) only for the minimum.
+    bool top = IsNegative();
+    if (carry != 0 || (top && !(negative && IsMinimum()))) {
+      throw std::out_of_range("does not fit into FixedBigInt");
+    }
+    if (negative) {
+      *this = -*this;
+    }
+  }
+
+  explicit FixedBigInt(const BigInt& num) : FixedBigInt(ToString(num)) {}
+
+  static constexpr FixedBigInt FromLimbs(const Limbs& limbs) {
+    FixedBigInt result;
+    result.limbs_ = limbs;
+    return result;
+  }
+
+  static constexpr FixedBigInt Max() {
+    FixedBigInt result = Min();
+    return ~result;
+  }
+
+  static constexpr FixedBigInt Min() {
+    FixedBigInt result;
+    result.limbs_[kLimbs - 1] = uint32_t(1) << 31;
+    return result;
+  }
+
+  constexpr const Limbs& GetLimbs() const { return limbs_; }
+  constexpr bool IsNegative() const {
+    return (limbs_[kLimbs - 1] >> 31) != 0;
+  }
+
+  BigInt ToBigInt() const { return BigInt(ToString()); }
+
+  std::string ToString() const {
+    FixedBigInt magnitude = IsNegative() ? -*this : *this;
+    // Nine decimal digits at a time, least significant chunk first.
+    std::string digits;
+    do {
+      uint32_t chunk = magnitude.DivideSmall(kChunk);
+      bool last = magnitude.IsZero();
+      for (int i = 0; i < kChunkDigits && (!last || chunk != 0); ++i) {
+        digits.push_back(static_cast<char>('0' + chunk % 10));
+        chunk /= 10;
+      }
+    } while (!magnitude.IsZero());
+    if (digits.empty()) {
+      digits.push_back('0');
+    }
+    if (IsNegative()) {
+      digits.push_back('-');
+    }
+    return std::string(digits.rbegin(), digits.rend());
+  }
+
+  friend constexpr bool operator==(const FixedBigInt& left,
+                                   const FixedBigInt& right) {
+    for (size_t i = 0; i < kLimbs; ++i) {
+      if (left.limbs_[i] != right.limbs_[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  friend constexpr bool operator!=(const FixedBigInt& left,
+                                   const FixedBigInt& right) {
+    return !(left == right);
+  }
+  friend constexpr bool operator<(const FixedBigInt& left,
+                                  const FixedBigInt& right) {
+    if (left.IsNegative() != right.IsNegative()) {
+      return left.IsNegative();
+    }
+    return UnsignedLess(left, right);
+  }
+  friend constexpr bool operator>(const FixedBigInt& left,
+                                  const FixedBigInt& right) {
+    return right < left;
+  }
+  friend constexpr bool operator<=(const FixedBigInt& left,
+                                   const FixedBigInt& right) {
+    return !(right < left);
+  }
+  friend constexpr bool operator>=(const FixedBigInt& left,
+                                   const FixedBigInt& right) {
+    return !(left < right);
+  }
+
+  constexpr FixedBigInt operator-() const {
+    FixedBigInt result = ~*this;
+    return ++result;
+  }
+
+  constexpr FixedBigInt operator~() const {
+    FixedBigInt result;
+    for (size_t i = 0; i < kLimbs; ++i) {
+      result.limbs_[i] = ~limbs_[i];
+    }
+    return result;
+  }
+
+  constexpr FixedBigInt& operator+=(const FixedBigInt& other) {
+    Add(other, std::make_index_sequence<kLimbs>());
+    return *this;
+  }
+
+  constexpr FixedBigInt& operator-=(const FixedBigInt& other) {
+    Subtract(other, std::make_index_sequence<kLimbs>());
+    return *this;
+  }
+
+  // Schoolbook product truncated to kLimbs limbs, which is exact modulo
+  // 2^Bits for either sign. The trip counts are compile-time constants, so
+  // the compiler unrolls the loops for the small widths.
+  constexpr FixedBigInt& operator*=(const FixedBigInt& other) {
+    Limbs result{};
+    for (size_t i = 0; i < kLimbs; ++i) {
+      uint64_t carry = 0;
+      for (size_t j = 0; j + i < kLimbs; ++j) {
+        uint64_t cur = uint64_t(limbs_[i]) * other.limbs_[j] +
+                       result[i + j] + carry;
+        result[i + j] = static_cast<uint32_t>(cur);
+        carry = cur >> 32;
+      }
+    }
+    limbs_ = result;
+    return *this;
+  }
+
+  constexpr FixedBigInt& operator/=(const FixedBigInt& other) {
+    FixedBigInt remainder;
+    DivMod(other, *this, remainder);
+    return *this;
+  }
+
+  constexpr FixedBigInt& operator%=(const FixedBigInt& other) {
+    FixedBigInt quotient;
+    DivMod(other, quotient, *this);
+    return *this;
+  }
+
+  constexpr FixedBigInt& operator&=(const FixedBigInt& other) {
+    for (size_t i = 0; i < kLimbs; ++i) {
+      limbs_[i] &= other.limbs_[i];
+    }
+    return *this;
+  }
+
+  constexpr FixedBigInt& operator|=(const FixedBigInt& other) {
+    for (size_t i = 0; i < kLimbs; ++i) {
+      limbs_[i] |= other.limbs_[i];
+    }
+    return *this;
+  }
+
+  constexpr FixedBigInt& operator^=(const FixedBigInt& other) {
+    for (size_t i = 0; i < kLimbs; ++i) {
+      limbs_[i] ^= other.limbs_[i];
+    }
+    return *this;
+  }
+
+  constexpr FixedBigInt& operator<<=(size_t shift) {
+    if (shift >= Bits) {
+      return *this = FixedBigInt();
+    }
+    size_t limb_shift = shift / 32;
+    size_t bit_shift = shift % 32;
+    for (size_t i = kLimbs; i-- > 0;) {
+      uint32_t value = 0;
+      if (i >= limb_shift) {
+        value = limbs_[i - limb_shift] << bit_shift;
+        if (bit_shift != 0 && i > limb_shift) {
+          value |= limbs_[i - limb_shift - 1] >> (32 - bit_shift);
+        }
+      }
+      limbs_[i] = value;
+    }
+    return *this;
+  }
+
+  // Arithmetic shift: the sign is kept.
+  constexpr FixedBigInt& operator>>=(size_t shift) {
+    uint32_t fill = IsNegative() ? ~uint32_t(0) : 0;
+    if (shift >= Bits) {
+      for (uint32_t& limb : limbs_) {
+        limb = fill;
+      }
+      return *this;
+    }
+    size_t limb_shift = shift / 32;
+    size_t bit_shift = shift % 32;
+    for (size_t i = 0; i < kLimbs; ++i) {
+      size_t from = i + limb_shift;
+      uint32_t low = from < kLimbs ? limbs_[from] : fill;
+      uint32_t high = from + 1 < kLimbs ? limbs_[from + 1] : fill;
+      limbs_[i] = bit_shift == 0
+                      ? low
+                      : (low >> bit_shift) | (high << (32 - bit_shift));
+    }
+    return *this;
+  }
+
+  friend constexpr FixedBigInt operator+(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left += right;
+  }
+  friend constexpr FixedBigInt operator-(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left -= right;
+  }
+  friend constexpr FixedBigInt operator*(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left *= right;
+  }
+  friend constexpr FixedBigInt operator/(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left /= right;
+  }
+  friend constexpr FixedBigInt operator%(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left %= right;
+  }
+  friend constexpr FixedBigInt operator&(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left &= right;
+  }
+  friend constexpr FixedBigInt operator|(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left |= right;
+  }
+  friend constexpr FixedBigInt operator^(FixedBigInt left,
+                                         const FixedBigInt& right) {
+    return left ^= right;
+  }
+  friend constexpr FixedBigInt operator<<(FixedBigInt left, size_t shift) {
+    return left <<= shift;
+  }
+  friend constexpr FixedBigInt operator>>(FixedBigInt left, size_t shift) {
+    return left >>= shift;
+  }
+
+  constexpr FixedBigInt& operator++() { return *this += 1; }
+  constexpr FixedBigInt operator++(int) {
+    FixedBigInt result = *this;
+    ++*this;
+    return result;
+  }
+  constexpr FixedBigInt& operator--() { return *this -= 1; }
+  constexpr FixedBigInt operator--(int) {
+    FixedBigInt result = *this;
+    --*this;
+    return result;
+  }
+
+  friend std::ostream& operator<<(std::ostream& ost, const FixedBigInt& out) {
+    return ost << out.ToString();
+  }
+
+  friend std::istream& operator>>(std::istream& ist, FixedBigInt& inside) {
+    std::string temp;
+    ist >> temp;
+    inside = FixedBigInt(temp);
+    return ist;
+  }
+
+ private:
+  static constexpr uint32_t kChunk = 1000000000;
+  static constexpr int kChunkDigits = 9;
+
+  static std::string ToString(const BigInt& num) {
+    std::ostringstream out;
+    out << num;
+    return out.str();
+  }
+
+  constexpr bool IsZero() const { return *this == FixedBigInt(); }
+  constexpr bool IsMinimum() const { return *this == Min(); }
+
+  static constexpr bool UnsignedLess(const FixedBigInt& left,
+                                     const FixedBigInt& right) {
+    for (size_t i = kLimbs; i-- > 0;) {
+      if (left.limbs_[i] != right.limbs_[i]) {
+        return left.limbs_[i] < right.limbs_[i];
+      }
+    }
+    return false;
+  }
+
+  template <size_t... I>
+  constexpr void Add(const FixedBigInt& other, std::index_sequence<I...>) {
+    uint64_t carry = 0;
+    ((carry += uint64_t(limbs_[I]) + other.limbs_[I],
+      limbs_[I] = static_cast<uint32_t>(carry), carry >>= 32),
+     ...);
+  }
+
+  template <size_t... I>
+  constexpr void Subtract(const FixedBigInt& other, std::index_sequence<I...>) {
+    uint64_t borrow = 0;
+    ((borrow = uint64_t(limbs_[I]) - other.limbs_[I] - borrow,
+      limbs_[I] = static_cast<uint32_t>(borrow), borrow = (borrow >> 32) & 1),
+     ...);
+  }
+
+  // *this = *this * factor + addend as unsigned numbers; returns what falls
+  // off the top.
+  constexpr uint32_t MultiplyAdd(uint32_t factor, uint32_t addend) {
+    uint64_t carry = addend;
+    for (size_t i = 0; i < kLimbs; ++i) {
+      carry += uint64_t(limbs_[i]) * factor;
+      limbs_[i] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    return static_cast<uint32_t>(carry);
+  }
+
+  // Divides as an unsigned number and returns the remainder.
+  constexpr uint32_t DivideSmall(uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (size_t i = kLimbs; i-- > 0;) {
+      uint64_t cur = (remainder << 32) | limbs_[i];
+      limbs_[i] = static_cast<uint32_t>(cur / divisor);
+      remainder = cur % divisor;
+    }
+    return static_cast<uint32_t>(remainder);
+  }
+
+  constexpr void DivMod(const FixedBigInt& other, FixedBigInt& quotient,
+                        FixedBigInt& remainder) const {
+    if (other.IsZero()) {
+      throw std::invalid_argument("Division by zero");
+    }
+    bool negative = IsNegative();
+    bool flip = negative != other.IsNegative();
+    // As unsigned numbers the magnitude of Min() is exact.
+    FixedBigInt dividend = negative ? -*this : *this;
+    FixedBigInt divisor = other.IsNegative() ? -other : other;
+    quotient = dividend;
+    remainder = FixedBigInt();
+    if (UnsignedLess(divisor, FixedBigInt(1) << 32)) {
+      remainder.limbs_[0] = quotient.DivideSmall(divisor.limbs_[0]);
+    } else {
+      // Shift-subtract, one bit at a time from the top set limb down.
+      quotient = FixedBigInt();
+      size_t top = kLimbs;
+      while (top > 0 && dividend.limbs_[top - 1] == 0) {
+        --top;
+      }
+      for (size_t bit = top * 32; bit-- > 0;) {
+        remainder <<= 1;
+        remainder.limbs_[0] |= (dividend.limbs_[bit / 32] >> (bit % 32)) & 1;
+        if (!UnsignedLess(remainder, divisor)) {
+          remainder -= divisor;
+          quotient.limbs_[bit / 32] |= uint32_t(1) << (bit % 32);
+        }
+      }
+    }
+    if (flip) {
+      quotient = -quotient;
+    }
+    if (negative) {
+      remainder = -remainder;
+    }
+  }
+
+  Limbs limbs_{};
+};
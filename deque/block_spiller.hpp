@@ -0,0 +1,172 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Hands out fixed-size blocks from an unlinked temporary file. The file is
+// mapped in extents of many blocks, so the number of mappings stays small
+// however long the queue grows; blocks are packed back to back and only
+// whole extents are rounded to pages. Evicted blocks leave the process's
+// resident set and live on in the page cache, from where the kernel writes
+// them back to the file and reclaims them under memory pressure; touching
+// them again faults them back in. A block keeps its address until it is
+// deallocated.
+class BlockSpiller {
+ public:
+  // Target size of one extent; the file grows by whole extents.
+  static constexpr size_t kExtentBytes = size_t(8) << 20;
+
+  BlockSpiller(size_t block_bytes, const std::string& directory)
+      : page_(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+        block_bytes_(block_bytes) {
+    // The fewest blocks that end on a page boundary, repeated up to
+    // kExtentBytes.
+    size_t run = page_ / std::gcd(block_bytes_, page_);
+    extent_blocks_ = run * std::max<size_t>(1, kExtentBytes /
+                                                   (run * block_bytes_));
+    std::string path = directory + "/deque_spill_XXXXXX";
+    fd_ = mkstemp(path.data());
+    if (fd_ == -1) {
+      throw std::system_error(errno, std::generic_category(), "mkstemp");
+    }
+    unlink(path.c_str());
+  }
+  BlockSpiller(const BlockSpiller&) = delete;
+  BlockSpiller& operator=(const BlockSpiller&) = delete;
+  ~BlockSpiller() {
+    for (char* extent : extents_) {
+      munmap(extent, extent_bytes());
+    }
+    close(fd_);
+  }
+
+  void* allocate() {
+    size_t slot = next_slot_;
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      if (next_slot_ == extents_.size() * extent_blocks_) {
+        add_extent();
+      }
+      ++next_slot_;
+    }
+    free_[slot] = false;
+    return address(slot);
+  }
+
+  // Gives back the slot's pages, disk space included where the file system
+  // allows it. Only whole pages leave the page cache, so a page shared with
+  // a neighbouring block goes once that block is free as well; a page left
+  // cached would be mapped again by the fault-around of a later read.
+  // Once punching a hole fails, the file keeps its peak size instead and
+  // the pages are only dropped from the resident set.
+  void deallocate(void* block) {
+    auto extent = std::prev(extent_of_.upper_bound(static_cast<char*>(block)));
+    size_t slot = extent->second * extent_blocks_ +
+                  static_cast<size_t>(static_cast<char*>(block) -
+                                      extent->first) /
+                      block_bytes_;
+    free_slots_.push_back(slot);
+    free_[slot] = true;
+    size_t begin = slot * block_bytes_;
+    size_t end = begin + block_bytes_;
+    size_t first_page = begin / page_ * page_;
+    begin = first_page == begin || all_free(first_page, begin)
+                ? first_page
+                : first_page + page_;
+    size_t last_page = end / page_ * page_;
+    end = last_page == end || !all_free(end, last_page + page_)
+              ? last_page
+              : last_page + page_;
+    if (begin >= end) {
+      return;
+    }
+    if (punch_holes_ &&
+        fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  static_cast<off_t>(begin),
+                  static_cast<off_t>(end - begin)) == -1) {
+      punch_holes_ = false;
+    }
+    if (!punch_holes_) {
+      madvise(extent->first + (begin - extent->second * extent_bytes()),
+              end - begin, MADV_DONTNEED);
+    }
+  }
+
+  // Dirty pages of a shared mapping stay in the page cache, so this only
+  // drops them from the resident set; a page shared with a neighbouring
+  // block that is still in use just faults back in.
+  void evict(void* block) { advise(block, MADV_DONTNEED); }
+
+  void prefetch(void* block) { advise(block, MADV_WILLNEED); }
+
+ private:
+  size_t extent_bytes() const { return extent_blocks_ * block_bytes_; }
+
+  void* address(size_t slot) const {
+    return extents_[slot / extent_blocks_] +
+           slot % extent_blocks_ * block_bytes_;
+  }
+
+  void add_extent() {
+    off_t offset = static_cast<off_t>(extents_.size() * extent_bytes());
+    if (ftruncate(fd_, offset + static_cast<off_t>(extent_bytes())) == -1) {
+      throw std::system_error(errno, std::generic_category(), "ftruncate");
+    }
+    void* extent = mmap(nullptr, extent_bytes(), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd_, offset);
+    if (extent == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    // Read-around on a fault would bring punched pages behind the front
+    // back as zero pages; prefetch() reads ahead instead.
+    madvise(extent, extent_bytes(), MADV_RANDOM);
+    extents_.push_back(static_cast<char*>(extent));
+    extent_of_[static_cast<char*>(extent)] = extents_.size() - 1;
+    free_.resize(extents_.size() * extent_blocks_, true);
+  }
+
+  // Whether no allocated block overlaps [begin, end) of the file.
+  bool all_free(size_t begin, size_t end) const {
+    for (size_t slot = begin / block_bytes_; slot * block_bytes_ < end;
+         ++slot) {
+      if (!free_[slot]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Applies advice to the pages the block overlaps.
+  void advise(void* block, int advice) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(block);
+    uintptr_t begin = address / page_ * page_;
+    uintptr_t end = (address + block_bytes_ + page_ - 1) / page_ * page_;
+    madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+  }
+
+  size_t page_;
+  size_t block_bytes_;
+  size_t extent_blocks_;
+  int fd_;
+  bool punch_holes_ = true;
+  std::vector<char*> extents_;
+  // Extent index by start address, to find the slot of a block.
+  std::map<char*, size_t> extent_of_;
+  // Slots below next_slot_ that are free again.
+  size_t next_slot_ = 0;
+  std::vector<size_t> free_slots_;
+  // Per slot of the mapped extents, whether it holds no block.
+  std::vector<bool> free_;
+};
@@ -1,15 +1,41 @@
+#pragma once
+#include <algorithm>
 #include <initializer_list>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <utility>
+#include <type_traits>
 #include <vector>
 
+namespace deque_detail {
+// Allocators with evict(), such as SpillAllocator in spilling_deque.hpp,
+// hand out blocks that may be paged out.
+template <typename Alloc, typename = void>
+struct SpillsBlocks : std::false_type {};
+
+template <typename Alloc>
+struct SpillsBlocks<Alloc, std::void_t<decltype(&Alloc::evict)>>
+    : std::true_type {};
+};  // namespace deque_detail
+
 template <typename T, typename Allocator = std::allocator<T>>
 class Deque {
  public:
   using value_type = T;
   using allocator_type = Allocator;
 
+  // Elements per block. Every block but the first and the last is full.
+  static constexpr size_t kBlockSize = 1000;
+
+  // Elements stored contiguously in one block; data[0] is (*this)[offset].
+  template <typename U>
+  struct Segment {
+    U* data;
+    size_t size;
+    size_t offset;
+  };
+
   Deque(const Allocator& alloc = Allocator()) : alloc_(alloc) {}
 
   Deque(const Deque& other)
@@ -27,10 +53,10 @@ class Deque {
 
   Deque(Deque&& other) noexcept
       : alloc_(std::move(other.alloc_)),
-        array_(std::move(other.array_)),
         size_(other.size_),
+        front_index_(other.front_index_),
         back_index_(other.back_index_),
-        front_index_(other.front_index_) {
+        array_(std::move(other.array_)) {
     other.size_ = 0;
     other.back_index_ = 0;
     other.front_index_ = 0;
@@ -85,14 +111,12 @@ class Deque {
 
   Allocator get_allocator() const { return alloc_; }
 
+  // Blocks always stay with the allocator that allocated them: the old
+  // ones leave together with the old allocator.
   Deque& operator=(Deque&& other) noexcept {
     if (this != &other) {
-      Deque copy = std::move(other);
-      if (std::allocator_traits<
-              Allocator>::propagate_on_container_copy_assignment::value) {
-        alloc_ = std::move(other.alloc_);
-      }
-      *this = std::move(copy);
+      Deque moved = std::move(other);
+      swap(moved);
     }
     return *this;
   }
@@ -101,13 +125,14 @@ class Deque {
     if (this == &other) {
       return *this;
     }
-    Deque copy = other;
-    swap(copy);
-    copy.alloc_ = alloc_;
-    if (std::allocator_traits<
-            Allocator>::propagate_on_container_copy_assignment::value) {
-      alloc_ = other.alloc_;
+    Deque copy(std::allocator_traits<
+                   Allocator>::propagate_on_container_copy_assignment::value
+                   ? other.alloc_
+                   : alloc_);
+    for (size_t ind = 0; ind < other.size(); ++ind) {
+      copy.push_back(other[ind]);
     }
+    swap(copy);
     return *this;
   }
 
@@ -115,6 +140,32 @@ class Deque {
 
   bool empty() const { return size_ == 0; }
 
+  // Number of blocks holding elements.
+  size_t segment_count() const {
+    if (size_ == 0) {
+      return 0;
+    }
+    return (back_index_ - 1) / kBlockSize - front_index_ / kBlockSize + 1;
+  }
+
+  // Index of the segment holding (*this)[index].
+  size_t segment_of(size_t index) const {
+    return (front_index_ + index) / kBlockSize - front_index_ / kBlockSize;
+  }
+
+  Segment<T> segment(size_t index) {
+    Segment<const T> found = std::as_const(*this).segment(index);
+    return {const_cast<T*>(found.data), found.size, found.offset};
+  }
+
+  Segment<const T> segment(size_t index) const {
+    size_t block = front_index_ / kBlockSize + index;
+    size_t begin = std::max(front_index_, block * kBlockSize);
+    size_t end = std::min(back_index_, (block + 1) * kBlockSize);
+    return {array_[block] + begin % kBlockSize, end - begin,
+            begin - front_index_};
+  }
+
   T& operator[](size_t index) {
     size_t block_index = (front_index_ + index) / kBlockSize;
     size_t offset = (front_index_ + index) % kBlockSize;
@@ -131,14 +182,14 @@ class Deque {
     if (index >= size()) {
       throw std::out_of_range("out of range");
     }
-    return Deque<T>::operator[](index);
+    return (*this)[index];
   }
 
   T& at(size_t index) {
     if (index >= size()) {
       throw std::out_of_range("out of range");
     }
-    return Deque<T>::operator[](index);
+    return (*this)[index];
   }
 
   void push_back(const T& value) { emplace_back(value); }
@@ -190,6 +241,13 @@ class Deque {
 
     --back_index_;
     --size_;
+    if constexpr (kSpills) {
+      if (size_ == 0) {
+        clear();
+      } else if (back_index_ % kBlockSize == 0) {
+        release_back_block();
+      }
+    }
   }
 
   void pop_front() {
@@ -200,6 +258,13 @@ class Deque {
 
     ++front_index_;
     --size_;
+    if constexpr (kSpills) {
+      if (size_ == 0) {
+        clear();
+      } else if (front_index_ % kBlockSize == 0) {
+        release_front_block();
+      }
+    }
   }
 
   template <bool IsConst>
@@ -346,9 +411,10 @@ class Deque {
   }
 
  private:
+  static constexpr bool kSpills = deque_detail::SpillsBlocks<Allocator>::value;
+
   Allocator alloc_;
   size_t size_ = 0;
-  const size_t kBlockSize = 1000;
   size_t front_index_ = 0;
   size_t back_index_ = 0;
   std::vector<T*> array_;
@@ -356,6 +422,14 @@ class Deque {
   void ensure_back_capacity() {
     if (back_index_ % kBlockSize == 0) {
       array_.push_back(allocate_block());
+      if constexpr (kSpills) {
+        // The block that just left the hot tail goes cold.
+        size_t first = front_index_ / kBlockSize;
+        size_t hot = alloc_.hot_blocks();
+        if (array_.size() - first > 2 * hot) {
+          alloc_.evict(array_[array_.size() - 1 - hot]);
+        }
+      }
     }
   }
 
@@ -364,6 +438,20 @@ class Deque {
       array_.insert(array_.begin(), allocate_block());
       front_index_ = kBlockSize;
       back_index_ += kBlockSize;
+    } else if (kSpills && front_index_ % kBlockSize == 0 &&
+               array_[front_index_ / kBlockSize - 1] == nullptr) {
+      // Refills a slot left empty by release_front_block().
+      array_[front_index_ / kBlockSize - 1] = allocate_block();
+    } else {
+      return;
+    }
+    if constexpr (kSpills) {
+      // The block that just left the hot head goes cold.
+      size_t first = front_index_ / kBlockSize - 1;
+      size_t hot = alloc_.hot_blocks();
+      if (array_.size() - first > 2 * hot) {
+        alloc_.evict(array_[first + hot]);
+      }
     }
   }
 
@@ -371,14 +459,49 @@ class Deque {
     return std::allocator_traits<Allocator>::allocate(alloc_, kBlockSize);
   }
 
+  void deallocate_block(T* block) {
+    std::allocator_traits<Allocator>::deallocate(alloc_, block, kBlockSize);
+  }
+
   void handle_failed_construction() {
     if (back_index_ % kBlockSize == 0 && !array_.empty()) {
-      std::allocator_traits<Allocator>::deallocate(alloc_, array_.back(),
-                                                   kBlockSize);
+      deallocate_block(array_.back());
       array_.pop_back();
     }
   }
 
+  // With a spilling allocator an emptied end block is given back right
+  // away. A block released at the front leaves an empty slot, and the slots
+  // are dropped together once they make up half of array_, so that draining
+  // the deque does not shift array_ for every block.
+  void release_front_block() {
+    size_t released = front_index_ / kBlockSize;
+    deallocate_block(array_[released - 1]);
+    array_[released - 1] = nullptr;
+    if (2 * released >= array_.size()) {
+      for (size_t i = 0; i < released; ++i) {
+        // A block is left here if emplace_front() threw after allocating.
+        if (array_[i] != nullptr) {
+          deallocate_block(array_[i]);
+        }
+      }
+      array_.erase(array_.begin(), array_.begin() + released);
+      front_index_ -= released * kBlockSize;
+      back_index_ -= released * kBlockSize;
+    }
+    // The new front block was read ahead by the previous release.
+    size_t first = front_index_ / kBlockSize;
+    for (size_t i = 1; i <= alloc_.read_ahead() && first + i < array_.size();
+         ++i) {
+      alloc_.prefetch(array_[first + i]);
+    }
+  }
+
+  void release_back_block() {
+    deallocate_block(array_.back());
+    array_.pop_back();
+  }
+
   void clear() {
     for (size_t i = 0; i < size_; ++i) {
       size_t block = (front_index_ + i) / kBlockSize;
@@ -388,7 +511,9 @@ class Deque {
     size_ = 0;
 
     for (auto& block : array_) {
-      std::allocator_traits<Allocator>::deallocate(alloc_, block, kBlockSize);
+      if (block != nullptr) {
+        deallocate_block(block);
+      }
     }
     array_.clear();
     front_index_ = 0;
@@ -0,0 +1,305 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "deque.hpp"
+
+// Fork-join pool: run() hands task indices to the workers and to the calling
+// thread, and returns once every task has finished. One run() executes at a
+// time; a task must not call run() on its own pool.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+    for (size_t i = 1; i < threads; ++i) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  static ThreadPool& global() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  // Threads that execute tasks, the caller of run() included.
+  size_t size() const { return workers_.size() + 1; }
+
+  // Calls task(0) ... task(count - 1) and rethrows the first exception one
+  // of them threw.
+  void run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 1 || workers_.empty()) {
+      for (size_t i = 0; i < count; ++i) {
+        task(i);
+      }
+      return;
+    }
+    std::lock_guard<std::mutex> serial(run_mutex_);
+    Job job(task, count);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &job;
+      ++generation_;
+    }
+    wake_.notify_all();
+    execute(job);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&] {
+      return job.users == 0 &&
+             job.finished.load(std::memory_order_acquire) == count;
+    });
+    job_ = nullptr;
+    if (job.error) {
+      std::rethrow_exception(job.error);
+    }
+  }
+
+ private:
+  struct Job {
+    Job(const std::function<void(size_t)>& task, size_t count)
+        : task(task), count(count) {}
+
+    const std::function<void(size_t)>& task;
+    size_t count;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    // Guarded by mutex_.
+    size_t users = 0;
+    std::exception_ptr error;
+  };
+
+  void execute(Job& job) {
+    size_t index;
+    while ((index = job.next.fetch_add(1, std::memory_order_relaxed)) <
+           job.count) {
+      try {
+        job.task(index);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!job.error) {
+          job.error = std::current_exception();
+        }
+      }
+      job.finished.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  // A worker registers as a user before touching a job, so run() keeps the
+  // job alive until every worker that saw it has let go.
+  void work() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&] {
+        return stop_ || (job_ != nullptr && generation_ != seen);
+      });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      Job* job = job_;
+      ++job->users;
+      lock.unlock();
+      execute(*job);
+      lock.lock();
+      --job->users;
+      done_.notify_all();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  Job* job_ = nullptr;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+};
+
+namespace deque_parallel {
+// Tasks per pool thread, so that uneven work still spreads out.
+inline constexpr size_t kTasksPerThread = 4;
+
+// Splits [0, deque.size()) into at most parts ranges that start and end on
+// block boundaries; range i is [bounds[i], bounds[i + 1]).
+template <typename D>
+std::vector<size_t> partition(const D& deque, size_t parts) {
+  size_t segments = deque.segment_count();
+  parts = std::max<size_t>(1, std::min(parts, segments));
+  std::vector<size_t> bounds;
+  for (size_t part = 0; part <= parts; ++part) {
+    size_t segment = segments * part / parts;
+    bounds.push_back(segment == segments ? deque.size()
+                                         : deque.segment(segment).offset);
+  }
+  return bounds;
+}
+
+// Calls func(data, count, index) for the contiguous runs covering
+// [begin, end), where data[0] is deque[index].
+template <typename D, typename Func>
+void for_each_span(D& deque, size_t begin, size_t end, Func func) {
+  while (begin < end) {
+    auto segment = deque.segment(deque.segment_of(begin));
+    size_t skip = begin - segment.offset;
+    size_t count = std::min(end - begin, segment.size - skip);
+    func(segment.data + skip, count, begin);
+    begin += count;
+  }
+}
+
+inline size_t task_count(const ThreadPool& pool) {
+  return pool.size() * kTasksPerThread;
+}
+};  // namespace deque_parallel
+
+// The algorithms below split the deque along its blocks and let every task
+// work on plain arrays, so their inner loops are free to vectorize.
+
+template <typename T, typename Allocator, typename Func>
+void parallel_for_each(Deque<T, Allocator>& deque, Func func,
+                       ThreadPool& pool = ThreadPool::global()) {
+  std::vector<size_t> bounds = deque_parallel::partition(
+      deque, deque_parallel::task_count(pool));
+  pool.run(bounds.size() - 1, [&](size_t part) {
+    deque_parallel::for_each_span(
+        deque, bounds[part], bounds[part + 1],
+        [&](T* data, size_t count, size_t) {
+          for (size_t i = 0; i < count; ++i) {
+            func(data[i]);
+          }
+        });
+  });
+}
+
+// output[i] = func(input[i]); output must already hold input.size()
+// elements.
+template <typename T, typename AllocatorIn, typename U, typename AllocatorOut,
+          typename Func>
+void parallel_transform(const Deque<T, AllocatorIn>& input,
+                        Deque<U, AllocatorOut>& output, Func func,
+                        ThreadPool& pool = ThreadPool::global()) {
+  if (output.size() != input.size()) {
+    throw std::invalid_argument("output size differs from input size");
+  }
+  std::vector<size_t> bounds = deque_parallel::partition(
+      input, deque_parallel::task_count(pool));
+  pool.run(bounds.size() - 1, [&](size_t part) {
+    deque_parallel::for_each_span(
+        input, bounds[part], bounds[part + 1],
+        [&](const T* source, size_t count, size_t index) {
+          // The blocks of output need not line up with those of input.
+          deque_parallel::for_each_span(
+              output, index, index + count,
+              [&](U* target, size_t run, size_t at) {
+                const T* from = source + (at - index);
+                for (size_t i = 0; i < run; ++i) {
+                  target[i] = func(from[i]);
+                }
+              });
+        });
+  });
+}
+
+// Folds the elements with op, which must be associative; partial results
+// of neighbouring ranges are combined in order, starting from init.
+template <typename T, typename Allocator, typename Result, typename BinaryOp>
+Result parallel_reduce(const Deque<T, Allocator>& deque, Result init,
+                       BinaryOp op, ThreadPool& pool = ThreadPool::global()) {
+  std::vector<size_t> bounds = deque_parallel::partition(
+      deque, deque_parallel::task_count(pool));
+  size_t parts = bounds.size() - 1;
+  std::vector<Result> partial(parts, init);
+  std::vector<char> has_value(parts, 0);
+  pool.run(parts, [&](size_t part) {
+    deque_parallel::for_each_span(
+        deque, bounds[part], bounds[part + 1],
+        [&](const T* data, size_t count, size_t) {
+          size_t i = 0;
+          if (!has_value[part]) {
+            partial[part] = data[i++];
+            has_value[part] = 1;
+          }
+          Result acc = partial[part];
+          for (; i < count; ++i) {
+            acc = op(acc, data[i]);
+          }
+          partial[part] = acc;
+        });
+  });
+  Result result = init;
+  for (size_t part = 0; part < parts; ++part) {
+    if (has_value[part]) {
+      result = op(result, partial[part]);
+    }
+  }
+  return result;
+}
+
+template <typename T, typename Allocator, typename Result>
+Result parallel_reduce(const Deque<T, Allocator>& deque, Result init) {
+  return parallel_reduce(deque, init, std::plus<>());
+}
+
+// Moves the elements into a buffer, sorts one range per task, merges the
+// sorted runs pairwise in parallel rounds and moves the result back. Needs
+// T to be default constructible and move assignable.
+template <typename T, typename Allocator, typename Compare = std::less<>>
+void parallel_sort(Deque<T, Allocator>& deque, Compare comp = Compare(),
+                   ThreadPool& pool = ThreadPool::global()) {
+  std::vector<size_t> bounds = deque_parallel::partition(
+      deque, deque_parallel::task_count(pool));
+  size_t runs = bounds.size() - 1;
+  std::vector<T> buffer(deque.size());
+  pool.run(runs, [&](size_t part) {
+    deque_parallel::for_each_span(
+        deque, bounds[part], bounds[part + 1],
+        [&](T* data, size_t count, size_t index) {
+          std::move(data, data + count, buffer.begin() + index);
+        });
+    std::sort(buffer.begin() + bounds[part], buffer.begin() + bounds[part + 1],
+              comp);
+  });
+  std::vector<T> spare(runs > 1 ? deque.size() : 0);
+  for (size_t width = 1; width < runs; width *= 2) {
+    size_t pairs = (runs + 2 * width - 1) / (2 * width);
+    pool.run(pairs, [&](size_t pair) {
+      size_t first = bounds[2 * pair * width];
+      size_t middle = bounds[std::min(runs, (2 * pair + 1) * width)];
+      size_t last = bounds[std::min(runs, (2 * pair + 2) * width)];
+      std::merge(std::make_move_iterator(buffer.begin() + first),
+                 std::make_move_iterator(buffer.begin() + middle),
+                 std::make_move_iterator(buffer.begin() + middle),
+                 std::make_move_iterator(buffer.begin() + last),
+                 spare.begin() + first, comp);
+    });
+    buffer.swap(spare);
+  }
+  pool.run(runs, [&](size_t part) {
+    deque_parallel::for_each_span(
+        deque, bounds[part], bounds[part + 1],
+        [&](T* data, size_t count, size_t index) {
+          std::move(buffer.begin() + index, buffer.begin() + index + count,
+                    data);
+        });
+  });
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "block_spiller.hpp"
+#include "deque.hpp"
+
+// Settings for a Deque that spills its blocks to disk.
+struct SpillOptions {
+  // Where the backing file is created; it is unlinked right away.
+  std::string directory = "/tmp";
+  // Blocks at either end of the deque that are kept resident.
+  size_t hot_blocks = 2;
+  // Blocks behind the front that are read back ahead of pop_front().
+  size_t read_ahead = 2;
+};
+
+// Allocator for queues that outgrow memory: Deque blocks are mapped from a
+// file, only options.hot_blocks blocks at either end stay resident and the
+// blocks behind the front are read ahead as pop_front() reaches them.
+// Deque releases emptied blocks as they are popped. References to elements
+// stay valid as with std::allocator; accessing a cold element just reads
+// its block back in. A copy of a spilling deque spills to a file of its
+// own.
+//
+//   SpillingDeque<Event> events{SpillAllocator<Event>({"/var/tmp"})};
+template <typename T>
+class SpillAllocator {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "only trivially copyable elements can be spilled");
+
+ public:
+  using value_type = T;
+
+  explicit SpillAllocator(const SpillOptions& options = SpillOptions())
+      : options_(options),
+        spiller_(std::make_shared<BlockSpiller>(block_size() * sizeof(T),
+                                                options.directory)) {}
+
+  // Moving copies, so that a moved-from allocator, like the deque holding
+  // it, can still allocate.
+  SpillAllocator(const SpillAllocator&) = default;
+  SpillAllocator& operator=(const SpillAllocator&) = default;
+
+  SpillAllocator select_on_container_copy_construction() const {
+    return SpillAllocator(options_);
+  }
+
+  // Only whole Deque blocks can be allocated.
+  T* allocate(size_t count) {
+    if (count != block_size()) {
+      throw std::invalid_argument("spilled allocations are whole blocks");
+    }
+    return static_cast<T*>(spiller_->allocate());
+  }
+
+  void deallocate(T* block, size_t) { spiller_->deallocate(block); }
+
+  // Used by Deque.
+  size_t hot_blocks() const {
+    return std::max<size_t>(1, options_.hot_blocks);
+  }
+  size_t read_ahead() const { return options_.read_ahead; }
+  void evict(T* block) { spiller_->evict(block); }
+  void prefetch(T* block) { spiller_->prefetch(block); }
+
+  friend bool operator==(const SpillAllocator& left,
+                         const SpillAllocator& right) {
+    return left.spiller_ == right.spiller_;
+  }
+
+  friend bool operator!=(const SpillAllocator& left,
+                         const SpillAllocator& right) {
+    return !(left == right);
+  }
+
+ private:
+  static constexpr size_t block_size() {
+    return Deque<T, SpillAllocator>::kBlockSize;
+  }
+
+  SpillOptions options_;
+  std::shared_ptr<BlockSpiller> spiller_;
+};
+
+template <typename T>
+using SpillingDeque = Deque<T, SpillAllocator<T>>;
@@ -0,0 +1,834 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+#include "../smart_pointers/reclamation.hpp"
+
+// Doubly linked list safe for concurrent use, with lock-free push and pop at
+// both ends after M. Michael, "CAS-based lock-free algorithm for shared
+// deques", and per-node locking in the middle.
+//
+// The two end nodes and a status live in an immutable anchor, and every end
+// operation publishes a new one with a single compare-and-swap. The status
+// marks the one step left to do after that swap: a push still has to link
+// the node that used to be the end to the new one, a pop still has to claim
+// its node and swap in the anchor without it. Any thread that finds a step
+// pending completes it before going on, so no end operation waits for
+// another. Replaced anchors and unlinked nodes are retired to
+// EpochDomain::global(), which keeps them alive for threads that may still
+// be reading them; erased elements are therefore destroyed later, on
+// whichever thread reclaims them.
+//
+// Insertion and erasure in the middle lock the nodes whose links they change,
+// always from front to back, and check that these nodes are still linked to
+// each other before changing anything; when they are the ends, the change
+// goes through the anchor like a push or pop. A pop claims its node before
+// reading past it, so it waits for a middle operation that holds that very
+// node, and only for that one; pushes never wait.
+//
+// The outer link of an end node holds a tag, unique among the values that
+// link ever takes, instead of a pointer to a popped node. A delayed
+// compare-and-swap that expects an old link value therefore always fails
+// once the link has moved on, even if the memory of the popped node has been
+// reused in between.
+//
+// Iterators keep reading through concurrent changes; see const_iterator.
+// Since they may be reading an element while another thread pops it, pop
+// copies elements out rather than moving them, unless T cannot be copied.
+// The allocator must itself be safe to use from several threads.
+template <typename T, typename Allocator = std::allocator<T>>
+class ConcurrentList {
+ private:
+  enum Side : size_t { kFront = 0, kBack = 1 };
+
+  // Bits of Node::state. A node is only ever locked by a middle operation,
+  // and stays removed once it has left the list.
+  enum State : unsigned { kLocked = 1, kRemoved = 2 };
+
+  struct Node {
+    template <typename... Args>
+    Node(Args&&... args) : value(std::forward<Args>(args)...) {
+      links[kFront].store(fresh_tag(), std::memory_order_relaxed);
+      links[kBack].store(fresh_tag(), std::memory_order_relaxed);
+    }
+
+    uintptr_t fresh_tag() {
+      return tags.fetch_add(1, std::memory_order_relaxed) << 1 | 1;
+    }
+
+    // Indexed by Side: the neighbour's address, or an odd tag at an end.
+    std::atomic<uintptr_t> links[2];
+    std::atomic<uintptr_t> tags{0};
+    std::atomic<unsigned> state{0};
+    T value;
+  };
+
+  struct alignas(8) Anchor {
+    Node* ends[2];
+  };
+
+  // Kept in the low bits of the anchor word; kPushFront + side marks the
+  // link towards ends[side] as pending, kPopFront + side the removal of
+  // ends[side].
+  enum Status : uintptr_t {
+    kStable = 0,
+    kPushFront = 1,
+    kPushBack = 2,
+    kPopFront = 3,
+    kPopBack = 4,
+  };
+  static constexpr uintptr_t kStatusMask = 7;
+  static_assert(alignof(Anchor) > kStatusMask, "no room for the status");
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  // Forward iterator over the elements. While it is not at the end it keeps
+  // its thread inside an EpochDomain::global() guard, so the element it
+  // points to stays allocated after another thread erases or pops it, and
+  // incrementing goes on from where that element used to be. Elements
+  // inserted or erased meanwhile may or may not be visited. An iterator
+  // must stay on the thread that created it.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+    const_iterator(const const_iterator& other) : node_(other.node_) {
+      if (node_ != nullptr) {
+        guard_.emplace(EpochDomain::global());
+      }
+    }
+    const_iterator& operator=(const const_iterator& other) {
+      if (other.node_ != nullptr && !guard_) {
+        guard_.emplace(EpochDomain::global());
+      }
+      node_ = other.node_;
+      if (node_ == nullptr) {
+        guard_.reset();
+      }
+      return *this;
+    }
+
+    reference operator*() const { return node_->value; }
+    pointer operator->() const { return &node_->value; }
+
+    const_iterator& operator++() {
+      node_ = next_live(node_);
+      if (node_ == nullptr) {
+        guard_.reset();
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    friend bool operator==(const const_iterator& left,
+                           const const_iterator& right) {
+      return left.node_ == right.node_;
+    }
+
+    friend bool operator!=(const const_iterator& left,
+                           const const_iterator& right) {
+      return !(left == right);
+    }
+
+   private:
+    friend class ConcurrentList;
+
+    Node* node_ = nullptr;
+    std::optional<EpochDomain::Guard> guard_;
+  };
+  using iterator = const_iterator;
+
+  ConcurrentList() = default;
+  explicit ConcurrentList(const Allocator& alloc)
+      : alloc_(alloc), anchor_alloc_(alloc) {}
+  ConcurrentList(const ConcurrentList&) = delete;
+  ConcurrentList& operator=(const ConcurrentList&) = delete;
+  ~ConcurrentList() {
+    Anchor* anchor = anchor_of(anchor_.load(std::memory_order_acquire));
+    if (anchor == nullptr) {
+      return;
+    }
+    Node* current = anchor->ends[kFront];
+    while (current != nullptr) {
+      uintptr_t link = current->links[kBack].load(std::memory_order_relaxed);
+      destroy_node(current);
+      current = is_tag(link) ? nullptr : node_of(link);
+    }
+    destroy_anchor(anchor);
+  }
+
+  // Approximate while other threads are modifying the list.
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+  bool empty() const { return size() == 0; }
+
+  const_iterator begin() const {
+    const_iterator it;
+    it.guard_.emplace(EpochDomain::global());
+    Anchor* anchor = anchor_of(anchor_.load(std::memory_order_acquire));
+    Node* node = anchor != nullptr ? anchor->ends[kFront] : nullptr;
+    if (node != nullptr &&
+        (node->state.load(std::memory_order_acquire) & kRemoved) != 0) {
+      node = next_live(node);
+    }
+    it.node_ = node;
+    if (node == nullptr) {
+      it.guard_.reset();
+    }
+    return it;
+  }
+  const_iterator end() const { return const_iterator(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  template <typename... Args>
+  void emplace_front(Args&&... args) {
+    push(create_node(std::forward<Args>(args)...), kFront);
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    push(create_node(std::forward<Args>(args)...), kBack);
+  }
+
+  // Assigns the first element to value and removes it; returns false if the
+  // list is empty.
+  bool pop_front(T& value) { return pop(kFront, value); }
+
+  // Assigns the last element to value and removes it; returns false if the
+  // list is empty.
+  bool pop_back(T& value) { return pop(kBack, value); }
+
+  // Constructs an element right before pos, or at the back if pos is end().
+  // Returns false, without inserting, if the element at pos has been erased.
+  template <typename... Args>
+  bool emplace(const_iterator pos, Args&&... args) {
+    if (pos.node_ == nullptr) {
+      emplace_back(std::forward<Args>(args)...);
+      return true;
+    }
+    Node* node = create_node(std::forward<Args>(args)...);
+    bool linked;
+    try {
+      linked = link_before(node, pos.node_);
+    } catch (...) {
+      destroy_node(node);
+      throw;
+    }
+    if (!linked) {
+      destroy_node(node);
+    }
+    return linked;
+  }
+
+  bool insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  bool insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+
+  // Erases the element at pos; returns false if another thread erased or
+  // popped it first.
+  bool erase(const_iterator pos) { return unlink(pos.node_); }
+
+  // Calls func on every element, front to back, as an iterator sees them.
+  template <typename Func>
+  void for_each(Func func) const {
+    for (const T& value : *this) {
+      func(value);
+    }
+  }
+
+  // Constructs an element right before the first one satisfying pred, or at
+  // the back if there is none. Keeps a sorted list sorted with pred being
+  // "greater than the new value", as long as no other thread inserts in the
+  // same place at the same time.
+  template <typename Predicate, typename... Args>
+  void emplace_before_first(Predicate pred, Args&&... args) {
+    Node* node = create_node(std::forward<Args>(args)...);
+    while (true) {
+      const_iterator next;
+      try {
+        next = begin();
+        while (next != end() && !pred(*next)) {
+          ++next;
+        }
+        if (next != end() && link_before(node, next.node_)) {
+          return;
+        }
+      } catch (...) {
+        destroy_node(node);
+        throw;
+      }
+      if (next == end()) {
+        push(node, kBack);
+        return;
+      }
+    }
+  }
+
+  // Erases the elements satisfying pred, returns how many were erased.
+  template <typename Predicate>
+  size_t remove_if(Predicate pred) {
+    size_t removed = 0;
+    for (const_iterator it = begin(); it != end(); ++it) {
+      if (pred(*it) && erase(it)) {
+        ++removed;
+      }
+    }
+    return removed;
+  }
+
+ private:
+  using alloc_traits = std::allocator_traits<allocator_type>;
+  using node_alloc = typename alloc_traits::template rebind_alloc<Node>;
+  using node_alloc_traits = typename alloc_traits::template rebind_traits<Node>;
+  using anchor_alloc = typename alloc_traits::template rebind_alloc<Anchor>;
+  using anchor_alloc_traits =
+      typename alloc_traits::template rebind_traits<Anchor>;
+
+  // Frees a retired object through a copy of the allocator. Derives from it
+  // so that a stateless allocator gives an empty deleter, which the domain
+  // does not need to keep on the heap.
+  template <typename Alloc>
+  struct Deleter : Alloc {
+    using Traits = std::allocator_traits<Alloc>;
+
+    Deleter() = default;
+    explicit Deleter(const Alloc& alloc) : Alloc(alloc) {}
+
+    void operator()(typename Traits::value_type* ptr) {
+      Traits::destroy(*this, ptr);
+      Traits::deallocate(*this, ptr, 1);
+    }
+  };
+
+  static constexpr Side opposite(Side side) {
+    return side == kFront ? kBack : kFront;
+  }
+  static Anchor* anchor_of(uintptr_t word) {
+    return reinterpret_cast<Anchor*>(word & ~kStatusMask);
+  }
+  static uintptr_t status_of(uintptr_t word) { return word & kStatusMask; }
+  static uintptr_t pack(Anchor* anchor, uintptr_t status) {
+    return reinterpret_cast<uintptr_t>(anchor) | status;
+  }
+  static bool is_tag(uintptr_t link) { return (link & 1) != 0; }
+  static Node* node_of(uintptr_t link) {
+    return reinterpret_cast<Node*>(link);
+  }
+  static uintptr_t link_to(Node* node) {
+    return reinterpret_cast<uintptr_t>(node);
+  }
+
+  // The first node after node that has not been removed, or null at the
+  // back. Removed nodes keep their links, which still lead backwards.
+  static Node* next_live(Node* node) {
+    while (true) {
+      uintptr_t link = node->links[kBack].load(std::memory_order_acquire);
+      if (is_tag(link)) {
+        return nullptr;
+      }
+      node = node_of(link);
+      if ((node->state.load(std::memory_order_acquire) & kRemoved) == 0) {
+        return node;
+      }
+    }
+  }
+
+  void push(Node* node, Side side) {
+    Side inner = opposite(side);
+    Anchor* spare = nullptr;
+    // Left over from a failed link_before(), if any.
+    node->links[side].store(node->fresh_tag(), std::memory_order_relaxed);
+    try {
+      EpochDomain::Guard guard(EpochDomain::global());
+      while (true) {
+        if (spare == nullptr) {
+          spare = create_anchor();
+        }
+        uintptr_t word = anchor_.load(std::memory_order_acquire);
+        Anchor* anchor = anchor_of(word);
+        if (anchor == nullptr) {
+          node->links[inner].store(node->fresh_tag(),
+                                   std::memory_order_relaxed);
+          spare->ends[kFront] = spare->ends[kBack] = node;
+          if (swap_anchor(word, pack(spare, kStable))) {
+            break;
+          }
+        } else if (status_of(word) == kStable) {
+          node->links[inner].store(link_to(anchor->ends[side]),
+                                   std::memory_order_relaxed);
+          spare->ends[side] = node;
+          spare->ends[inner] = anchor->ends[inner];
+          uintptr_t pushed = pack(spare, kPushFront + side);
+          if (swap_anchor(word, pushed)) {
+            stabilize(pushed);
+            retire(anchor);
+            break;
+          }
+        } else {
+          help(word, spare);
+        }
+      }
+    } catch (...) {
+      if (spare != nullptr) {
+        destroy_anchor(spare);
+      }
+      destroy_node(node);
+      throw;
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool pop(Side side, T& value) {
+    Anchor* spare = nullptr;
+    Node* node = nullptr;
+    try {
+      EpochDomain::Guard guard(EpochDomain::global());
+      while (true) {
+        uintptr_t word = anchor_.load(std::memory_order_acquire);
+        Anchor* anchor = anchor_of(word);
+        if (anchor == nullptr) {
+          break;
+        }
+        if (status_of(word) != kStable) {
+          help(word, spare);
+        } else if (spare == nullptr) {
+          // Allocated before the pop is published, so that finishing it
+          // cannot fail.
+          spare = create_anchor();
+        } else if (swap_anchor(word, word | (kPopFront + side))) {
+          node = anchor->ends[side];
+          finish_pop(word | (kPopFront + side), spare);
+          break;
+        }
+      }
+    } catch (...) {
+      if (spare != nullptr) {
+        destroy_anchor(spare);
+      }
+      throw;
+    }
+    if (spare != nullptr) {
+      destroy_anchor(spare);
+    }
+    if (node == nullptr) {
+      return false;
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    try {
+      if constexpr (std::is_copy_assignable_v<T>) {
+        value = node->value;
+      } else {
+        value = std::move(node->value);
+      }
+    } catch (...) {
+      retire(node);
+      throw;
+    }
+    retire(node);
+    return true;
+  }
+
+  // Completes the pending step recorded in word; spare is the anchor to
+  // publish if that needs one and is allocated here if missing.
+  void help(uintptr_t word, Anchor*& spare) {
+    if (status_of(word) < kPopFront) {
+      stabilize(word);
+      return;
+    }
+    if (spare == nullptr) {
+      spare = create_anchor();
+    }
+    finish_pop(word, spare);
+  }
+
+  // Completes the push recorded in word by linking the node that used to
+  // be the end to the new end, then marks the anchor stable. The link is
+  // only trusted if the anchor is still word after reading it.
+  void stabilize(uintptr_t word) {
+    Anchor* anchor = anchor_of(word);
+    Side side = static_cast<Side>(status_of(word) - kPushFront);
+    Node* end = anchor->ends[side];
+    uintptr_t back = end->links[opposite(side)].load(std::memory_order_acquire);
+    if (is_tag(back)) {
+      // The node before has been popped, so the anchor has moved on.
+      return;
+    }
+    Node* before = node_of(back);
+    uintptr_t link = before->links[side].load(std::memory_order_acquire);
+    if (anchor_.load(std::memory_order_acquire) != word) {
+      return;
+    }
+    if (link != link_to(end) &&
+        !before->links[side].compare_exchange_strong(
+            link, link_to(end), std::memory_order_acq_rel,
+            std::memory_order_relaxed)) {
+      return;
+    }
+    swap_anchor(word, pack(anchor, kStable));
+  }
+
+  // Completes the pop recorded in word: claims the end node, waiting for a
+  // middle operation that holds it, which keeps the link past it still; then
+  // turns the link back to it into a tag and publishes the anchor without
+  // it, built in spare. Whoever publishes retires the old anchor.
+  void finish_pop(uintptr_t word, Anchor*& spare) {
+    Anchor* anchor = anchor_of(word);
+    Side side = static_cast<Side>(status_of(word) - kPopFront);
+    Side inner = opposite(side);
+    Node* victim = anchor->ends[side];
+    unsigned state = victim->state.load(std::memory_order_acquire);
+    while (state != kRemoved) {
+      if (state == kLocked) {
+        if (anchor_.load(std::memory_order_acquire) != word) {
+          return;
+        }
+        std::this_thread::yield();
+        state = victim->state.load(std::memory_order_acquire);
+      } else {
+        victim->state.compare_exchange_weak(state, kRemoved,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire);
+      }
+    }
+    uintptr_t replacement = 0;
+    if (anchor->ends[kFront] != anchor->ends[kBack]) {
+      Node* next =
+          node_of(victim->links[inner].load(std::memory_order_acquire));
+      uintptr_t expected = link_to(victim);
+      next->links[side].compare_exchange_strong(
+          expected, next->fresh_tag(), std::memory_order_acq_rel,
+          std::memory_order_relaxed);
+      spare->ends[side] = next;
+      spare->ends[inner] = anchor->ends[inner];
+      replacement = pack(spare, kStable);
+    }
+    if (swap_anchor(word, replacement)) {
+      if (replacement != 0) {
+        spare = nullptr;
+      }
+      retire(anchor);
+    }
+  }
+
+  bool swap_anchor(uintptr_t expected, uintptr_t desired) {
+    return anchor_.compare_exchange_strong(expected, desired,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_relaxed);
+  }
+
+  // Helps a pending step along before a middle operation tries again. Only
+  // called without node locks held, since finishing a pop may wait for one.
+  void retry(Anchor*& spare) {
+    uintptr_t word = anchor_.load(std::memory_order_acquire);
+    if (status_of(word) != kStable) {
+      help(word, spare);
+    }
+  }
+
+  // A pending push may still rewrite the link it completes, so one is
+  // completed before a middle operation changes links next to it.
+  void settle_push() {
+    uintptr_t word = anchor_.load(std::memory_order_acquire);
+    if (status_of(word) == kPushFront || status_of(word) == kPushBack) {
+      stabilize(word);
+    }
+  }
+
+  // Waits out other middle operations on node; fails once it is removed.
+  static bool lock(Node* node) {
+    unsigned state = node->state.load(std::memory_order_relaxed);
+    while (true) {
+      if (state & kRemoved) {
+        return false;
+      }
+      if (state & kLocked) {
+        std::this_thread::yield();
+        state = node->state.load(std::memory_order_relaxed);
+      } else if (node->state.compare_exchange_weak(
+                     state, kLocked, std::memory_order_acquire,
+                     std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+
+  static void unlock(Node* node) {
+    if (node != nullptr) {
+      node->state.store(0, std::memory_order_release);
+    }
+  }
+
+  // Links node in front of next unless next has been removed; at the front
+  // end this is a push that only succeeds while next is still the front.
+  bool link_before(Node* node, Node* next) {
+    Anchor* spare = nullptr;
+    bool linked = false;
+    try {
+      EpochDomain::Guard guard(EpochDomain::global());
+      while (true) {
+        uintptr_t link = next->links[kFront].load(std::memory_order_acquire);
+        Node* prev = is_tag(link) ? nullptr : node_of(link);
+        if (prev != nullptr && !lock(prev)) {
+          // next will get a new neighbour or be removed as well.
+          if (next->state.load(std::memory_order_acquire) & kRemoved) {
+            break;
+          }
+          retry(spare);
+          continue;
+        }
+        if (!lock(next)) {
+          unlock(prev);
+          break;
+        }
+        if (next->links[kFront].load(std::memory_order_acquire) != link ||
+            (prev != nullptr &&
+             prev->links[kBack].load(std::memory_order_acquire) !=
+                 link_to(next))) {
+          unlock(prev);
+          unlock(next);
+          retry(spare);
+          continue;
+        }
+        if (prev != nullptr) {
+          settle_push();
+          node->links[kFront].store(link_to(prev), std::memory_order_relaxed);
+          node->links[kBack].store(link_to(next), std::memory_order_relaxed);
+          prev->links[kBack].store(link_to(node), std::memory_order_release);
+          next->links[kFront].store(link_to(node), std::memory_order_release);
+          unlock(prev);
+          unlock(next);
+          linked = true;
+          break;
+        }
+        uintptr_t word = anchor_.load(std::memory_order_acquire);
+        Anchor* anchor = anchor_of(word);
+        if (status_of(word) == kStable && anchor != nullptr &&
+            spare != nullptr && anchor->ends[kFront] == next) {
+          node->links[kFront].store(node->fresh_tag(),
+                                    std::memory_order_relaxed);
+          node->links[kBack].store(link_to(next), std::memory_order_relaxed);
+          spare->ends[kFront] = node;
+          spare->ends[kBack] = anchor->ends[kBack];
+          uintptr_t pushed = pack(spare, kPushFront);
+          if (swap_anchor(word, pushed)) {
+            spare = nullptr;
+            stabilize(pushed);
+            retire(anchor);
+            linked = true;
+          }
+        }
+        unlock(next);
+        if (linked) {
+          break;
+        }
+        if (spare == nullptr && status_of(word) == kStable) {
+          spare = create_anchor();
+        }
+        retry(spare);
+      }
+    } catch (...) {
+      if (spare != nullptr) {
+        destroy_anchor(spare);
+      }
+      throw;
+    }
+    if (spare != nullptr) {
+      destroy_anchor(spare);
+    }
+    if (linked) {
+      size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return linked;
+  }
+
+  // Erases node unless it has been removed already. With both neighbours
+  // locked the links around it are simply rewired; an end node is taken
+  // out of the anchor, and the link back to it turned into a tag, while
+  // its neighbour is still locked.
+  bool unlink(Node* node) {
+    Anchor* spare = nullptr;
+    bool unlinked = false;
+    try {
+      EpochDomain::Guard guard(EpochDomain::global());
+      while (true) {
+        uintptr_t front_link =
+            node->links[kFront].load(std::memory_order_acquire);
+        Node* prev = is_tag(front_link) ? nullptr : node_of(front_link);
+        if (prev != nullptr && !lock(prev)) {
+          if (node->state.load(std::memory_order_acquire) & kRemoved) {
+            break;
+          }
+          retry(spare);
+          continue;
+        }
+        if (!lock(node)) {
+          unlock(prev);
+          break;
+        }
+        uintptr_t back_link =
+            node->links[kBack].load(std::memory_order_acquire);
+        Node* next = is_tag(back_link) ? nullptr : node_of(back_link);
+        bool consistent =
+            node->links[kFront].load(std::memory_order_acquire) ==
+                front_link &&
+            (prev == nullptr ||
+             prev->links[kBack].load(std::memory_order_acquire) ==
+                 link_to(node));
+        if (consistent && next != nullptr) {
+          if (lock(next)) {
+            consistent = next->links[kFront].load(
+                             std::memory_order_acquire) == link_to(node);
+          } else {
+            consistent = false;
+            next = nullptr;
+          }
+        }
+        if (!consistent) {
+          unlock(prev);
+          unlock(node);
+          unlock(next);
+          retry(spare);
+          continue;
+        }
+        if (prev != nullptr && next != nullptr) {
+          settle_push();
+          prev->links[kBack].store(link_to(next), std::memory_order_release);
+          next->links[kFront].store(link_to(prev), std::memory_order_release);
+          unlinked = true;
+        } else {
+          unlinked = unlink_end(node, prev, next, spare);
+        }
+        unlock(prev);
+        unlock(next);
+        if (unlinked) {
+          node->state.store(kRemoved, std::memory_order_release);
+          break;
+        }
+        unlock(node);
+        if (spare == nullptr) {
+          spare = create_anchor();
+        }
+        retry(spare);
+      }
+    } catch (...) {
+      if (spare != nullptr) {
+        destroy_anchor(spare);
+      }
+      throw;
+    }
+    if (spare != nullptr) {
+      destroy_anchor(spare);
+    }
+    if (unlinked) {
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      retire(node);
+    }
+    return unlinked;
+  }
+
+  // Takes node, locked along with its neighbour if it has one, out of a
+  // stable anchor that has it as an end. Fails if the anchor is not like
+  // that or spare is missing; the caller then unlocks and helps.
+  bool unlink_end(Node* node, Node* prev, Node* next, Anchor*& spare) {
+    uintptr_t word = anchor_.load(std::memory_order_acquire);
+    Anchor* anchor = anchor_of(word);
+    if (status_of(word) != kStable || anchor == nullptr) {
+      return false;
+    }
+    Side side = prev == nullptr ? kFront : kBack;
+    Side inner = opposite(side);
+    Node* neighbour = prev == nullptr ? next : prev;
+    if (anchor->ends[side] != node ||
+        (neighbour == nullptr) != (anchor->ends[inner] == node)) {
+      return false;
+    }
+    uintptr_t replacement = 0;
+    if (neighbour != nullptr) {
+      if (spare == nullptr) {
+        return false;
+      }
+      spare->ends[side] = neighbour;
+      spare->ends[inner] = anchor->ends[inner];
+      replacement = pack(spare, kStable);
+    }
+    if (!swap_anchor(word, replacement)) {
+      return false;
+    }
+    if (neighbour != nullptr) {
+      spare = nullptr;
+      // Unless a push has already linked neighbour to a new end.
+      uintptr_t expected = link_to(node);
+      neighbour->links[side].compare_exchange_strong(
+          expected, neighbour->fresh_tag(), std::memory_order_acq_rel,
+          std::memory_order_relaxed);
+    }
+    retire(anchor);
+    return true;
+  }
+
+  template <typename... Args>
+  Node* create_node(Args&&... args) {
+    Node* node = node_alloc_traits::allocate(alloc_, 1);
+    try {
+      node_alloc_traits::construct(alloc_, node, std::forward<Args>(args)...);
+    } catch (...) {
+      node_alloc_traits::deallocate(alloc_, node, 1);
+      throw;
+    }
+    return node;
+  }
+
+  void destroy_node(Node* node) {
+    node_alloc_traits::destroy(alloc_, node);
+    node_alloc_traits::deallocate(alloc_, node, 1);
+  }
+
+  Anchor* create_anchor() {
+    Anchor* anchor = anchor_alloc_traits::allocate(anchor_alloc_, 1);
+    anchor_alloc_traits::construct(anchor_alloc_, anchor);
+    return anchor;
+  }
+
+  void destroy_anchor(Anchor* anchor) {
+    anchor_alloc_traits::destroy(anchor_alloc_, anchor);
+    anchor_alloc_traits::deallocate(anchor_alloc_, anchor, 1);
+  }
+
+  void retire(Node* node) {
+    EpochDomain::global().retire(node, Deleter<node_alloc>(alloc_));
+  }
+  void retire(Anchor* anchor) {
+    EpochDomain::global().retire(anchor, Deleter<anchor_alloc>(anchor_alloc_));
+  }
+
+  std::atomic<uintptr_t> anchor_{0};
+  std::atomic<size_t> size_{0};
+  node_alloc alloc_;
+  anchor_alloc anchor_alloc_;
+};
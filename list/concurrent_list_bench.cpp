@@ -0,0 +1,158 @@
+// Throughput of ConcurrentList against a List behind one mutex, for 1 to 64
+// threads that push and pop at random ends of one shared list, first alone
+// and then with a quarter of the operations inserting or erasing a few
+// elements in from the front.
+//
+//   g++ -std=c++17 -O2 -pthread concurrent_list_bench.cpp -o bench
+//   ./bench [milliseconds per run]
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "concurrent_list.hpp"
+#include "list.hpp"
+
+namespace {
+constexpr size_t kPrefill = 1000;
+// Middle operations walk up to this many elements in from the front.
+constexpr size_t kMaxWalk = 8;
+
+class LockedList {
+ public:
+  void push(bool front, long value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (front) {
+      list_.push_front(value);
+    } else {
+      list_.push_back(value);
+    }
+  }
+
+  bool pop(bool front, long& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (list_.empty()) {
+      return false;
+    }
+    if (front) {
+      value = list_.front();
+      list_.pop_front();
+    } else {
+      value = list_.back();
+      list_.pop_back();
+    }
+    return true;
+  }
+
+  void middle(size_t walk, bool insert, long value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pos = list_.cbegin();
+    for (size_t i = 0; i < walk && pos != list_.cend(); ++i) {
+      ++pos;
+    }
+    if (insert) {
+      list_.emplace(pos, value);
+    } else if (pos != list_.cend()) {
+      list_.erase(pos);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  List<long> list_;
+};
+
+class ConcurrentSubject {
+ public:
+  void push(bool front, long value) {
+    if (front) {
+      list_.push_front(value);
+    } else {
+      list_.push_back(value);
+    }
+  }
+
+  bool pop(bool front, long& value) {
+    return front ? list_.pop_front(value) : list_.pop_back(value);
+  }
+
+  void middle(size_t walk, bool insert, long value) {
+    auto pos = list_.begin();
+    for (size_t i = 0; i < walk && pos != list_.end(); ++i) {
+      ++pos;
+    }
+    if (insert) {
+      list_.emplace(pos, value);
+    } else if (pos != list_.end()) {
+      list_.erase(pos);
+    }
+  }
+
+ private:
+  ConcurrentList<long> list_;
+};
+
+// Million operations per second over all threads.
+template <typename Subject>
+double run(size_t threads, bool middle, std::chrono::milliseconds duration) {
+  Subject subject;
+  for (size_t i = 0; i < kPrefill; ++i) {
+    subject.push(false, static_cast<long>(i));
+  }
+  std::atomic<bool> start{false};
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> total{0};
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::minstd_rand random(static_cast<unsigned>(t + 1));
+      size_t ops = 0;
+      long value = 0;
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      while (!stop.load(std::memory_order_relaxed)) {
+        unsigned bits = static_cast<unsigned>(random());
+        if (middle && (bits & 12) == 0) {
+          subject.middle(bits >> 4 & (kMaxWalk - 1), bits & 1, value++);
+        } else if (bits & 1) {
+          subject.push(bits & 2, value++);
+        } else {
+          subject.pop(bits & 2, value);
+        }
+        ++ops;
+      }
+      total.fetch_add(ops, std::memory_order_relaxed);
+    });
+  }
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - begin;
+  return static_cast<double>(total.load()) / elapsed.count() / 1e6;
+}
+};  // namespace
+
+int main(int argc, char** argv) {
+  std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+  std::printf("%8s %8s %16s %16s\n", "threads", "middle", "locked Mop/s",
+              "concurrent Mop/s");
+  for (bool middle : {false, true}) {
+    for (size_t threads = 1; threads <= 64; threads *= 2) {
+      double locked = run<LockedList>(threads, middle, duration);
+      double concurrent = run<ConcurrentSubject>(threads, middle, duration);
+      std::printf("%8zu %8s %16.2f %16.2f\n", threads, middle ? "1/4" : "-",
+                  locked, concurrent);
+    }
+  }
+}
@@ -0,0 +1,245 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+struct DefaultListTag {};
+
+// Base class that makes an object linkable into an IntrusiveList with the
+// same Tag. An object may derive from several hooks with distinct tags to sit
+// in several lists at once. The hook unlinks itself on destruction.
+template <typename Tag = DefaultListTag>
+class IntrusiveListHook {
+ public:
+  IntrusiveListHook() = default;
+  // Copies of an object are not members of the original's list.
+  IntrusiveListHook(const IntrusiveListHook&) {}
+  IntrusiveListHook& operator=(const IntrusiveListHook&) { return *this; }
+  ~IntrusiveListHook() { unlink(); }
+
+  bool is_linked() const { return next != nullptr; }
+
+  // Removes the object from whatever list holds it, in O(1).
+  void unlink() {
+    if (next == nullptr) {
+      return;
+    }
+    prev->next = next;
+    next->prev = prev;
+    next = nullptr;
+    prev = nullptr;
+  }
+
+ private:
+  template <typename T, typename OtherTag>
+  friend class IntrusiveList;
+
+  IntrusiveListHook* next = nullptr;
+  IntrusiveListHook* prev = nullptr;
+};
+
+// Non-owning list of objects deriving from IntrusiveListHook<Tag>. Linking
+// never allocates. Since members may unlink themselves behind the list's
+// back, size() walks the list.
+template <typename T, typename Tag = DefaultListTag>
+class IntrusiveList {
+ private:
+  using BaseNode = IntrusiveListHook<Tag>;
+  static_assert(std::is_base_of_v<BaseNode, T>,
+                "T must derive from IntrusiveListHook<Tag>");
+
+  template <bool IsConst>
+  class BaseIterator;
+
+ public:
+  using value_type = T;
+  using reference = value_type&;
+  using const_reference = value_type const&;
+  using pointer = value_type*;
+  using const_pointer = value_type const*;
+  using iterator = BaseIterator<false>;
+  using const_iterator = BaseIterator<true>;
+  using difference_type = std::ptrdiff_t;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+ private:
+  template <bool IsConst = false>
+  class BaseIterator {
+   public:
+    using value_type = typename std::conditional<IsConst, const T, T>::type;
+    using reference = typename std::conditional<IsConst, const T&, T&>::type;
+    using pointer = typename std::conditional<IsConst, const T*, T*>::type;
+    using iterator_category = typename std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using base_node_pointer =
+        typename std::conditional<IsConst, const BaseNode*, BaseNode*>::type;
+
+    BaseIterator() = default;
+    explicit BaseIterator(base_node_pointer node) : current_(node) {}
+    template <bool OtherConst,
+              typename = std::enable_if_t<IsConst && !OtherConst>>
+    BaseIterator(const BaseIterator<OtherConst>& src)
+        : current_(src.current_) {}
+
+    reference operator*() const { return *static_cast<pointer>(current_); }
+    pointer operator->() const { return static_cast<pointer>(current_); }
+    BaseIterator& operator++() {
+      current_ = current_->next;
+      return *this;
+    }
+    BaseIterator operator++(int) {
+      BaseIterator prev = *this;
+      ++(*this);
+      return prev;
+    }
+    BaseIterator& operator--() {
+      current_ = current_->prev;
+      return *this;
+    }
+    BaseIterator operator--(int) {
+      BaseIterator prev = *this;
+      --(*this);
+      return prev;
+    }
+    // Templated on the other constness, so that iterators and
+    // const_iterators compare with each other.
+    template <bool OtherConst>
+    bool operator==(const BaseIterator<OtherConst>& other) const {
+      return current_ == other.current_;
+    }
+    template <bool OtherConst>
+    bool operator!=(const BaseIterator<OtherConst>& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class IntrusiveList;
+    template <bool OtherConst>
+    friend class BaseIterator;
+
+    base_node_pointer current_ = nullptr;
+  };
+
+ public:
+  IntrusiveList() { reset(); }
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+  IntrusiveList(IntrusiveList&& other) noexcept {
+    reset();
+    take_nodes(other);
+  }
+  IntrusiveList& operator=(IntrusiveList&& other) noexcept {
+    if (this != &other) {
+      clear();
+      take_nodes(other);
+    }
+    return *this;
+  }
+  ~IntrusiveList() { clear(); }
+
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *--end(); }
+  const T& back() const { return *--end(); }
+  bool empty() const { return fake_node_.next == &fake_node_; }
+  size_t size() const {
+    return static_cast<size_t>(std::distance(begin(), end()));
+  }
+
+  void push_front(T& value) { insert(cbegin(), value); }
+  void push_back(T& value) { insert(cend(), value); }
+  void pop_front() {
+    if (!empty()) {
+      erase(cbegin());
+    }
+  }
+  void pop_back() {
+    if (!empty()) {
+      erase(--cend());
+    }
+  }
+
+  // Links value before pos, first unlinking it from any list it was in.
+  iterator insert(const_iterator pos, T& value) {
+    BaseNode* node = &value;
+    BaseNode* next = const_cast<BaseNode*>(pos.current_);
+    if (node == next) {
+      return iterator(node);
+    }
+    node->unlink();
+    node->prev = next->prev;
+    node->next = next;
+    next->prev->next = node;
+    next->prev = node;
+    return iterator(node);
+  }
+
+  iterator erase(const_iterator pos) {
+    BaseNode* node = const_cast<BaseNode*>(pos.current_);
+    BaseNode* next = node->next;
+    node->unlink();
+    return iterator(next);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator(const_cast<BaseNode*>(last.current_));
+  }
+
+  void clear() {
+    BaseNode* current = fake_node_.next;
+    while (current != &fake_node_) {
+      BaseNode* next = current->next;
+      current->next = nullptr;
+      current->prev = nullptr;
+      current = next;
+    }
+    reset();
+  }
+
+  // O(1) iterator to an element known to be in this list.
+  iterator iterator_to(T& value) {
+    return iterator(static_cast<BaseNode*>(&value));
+  }
+  const_iterator iterator_to(const T& value) const {
+    return const_iterator(static_cast<const BaseNode*>(&value));
+  }
+
+  iterator begin() { return iterator(fake_node_.next); }
+  const_iterator begin() const { return const_iterator(fake_node_.next); }
+  iterator end() { return iterator(&fake_node_); }
+  const_iterator end() const { return const_iterator(&fake_node_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+
+ private:
+  void reset() {
+    fake_node_.next = &fake_node_;
+    fake_node_.prev = &fake_node_;
+  }
+
+  void take_nodes(IntrusiveList& other) {
+    if (other.empty()) {
+      return;
+    }
+    fake_node_.next = other.fake_node_.next;
+    fake_node_.prev = other.fake_node_.prev;
+    fake_node_.next->prev = &fake_node_;
+    fake_node_.prev->next = &fake_node_;
+    other.reset();
+  }
+
+  BaseNode fake_node_;
+};
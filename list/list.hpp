@@ -1,5 +1,7 @@
 #include <algorithm>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
 
 template <typename T, typename Allocator = std::allocator<T>>
@@ -32,18 +34,40 @@ class List {
   };
   struct Node : public BaseNode {
     T value;
-    Node() : value(T()) {}
-    Node(const T& val) : value(val) {}
+    template <typename... Args>
+    Node(Args&&... args) : value(std::forward<Args>(args)...) {}
   };
-  Node* head_ = nullptr;
-  Node* tail_ = nullptr;
-  BaseNode fake_node_;
-  BaseNode* fake_ = nullptr;
+  // The nodes form a ring through fake_node_, which is both the node before
+  // the first element and end(). An empty list is fake_node_ linked to itself.
+  BaseNode fake_node_{&fake_node_, &fake_node_};
   using alloc_traits = std::allocator_traits<allocator_type>;
   using node_alloc = typename alloc_traits::template rebind_alloc<Node>;
   using node_alloc_traits = typename alloc_traits::template rebind_traits<Node>;
   node_alloc alloc_;
 
+  template <typename InputIt>
+  using RequireInputIterator = std::enable_if_t<std::is_convertible_v<
+      typename std::iterator_traits<InputIt>::iterator_category,
+      std::input_iterator_tag>>;
+
+  template <typename Alloc, typename = void>
+  struct HasReserve : std::false_type {};
+  template <typename Alloc>
+  struct HasReserve<Alloc, std::void_t<decltype(std::declval<Alloc&>().reserve(
+                               std::declval<size_t>()))>> : std::true_type {};
+
+  template <typename Alloc, typename = void>
+  struct HasDestroy : std::false_type {};
+  template <typename Alloc>
+  struct HasDestroy<Alloc, std::void_t<decltype(std::declval<Alloc&>().destroy(
+                               std::declval<Node*>()))>> : std::true_type {};
+
+  // Destroying such nodes is a no-op unless the allocator wants to see it.
+  static constexpr bool kTrivialDestroy =
+      std::is_trivially_destructible_v<Node> &&
+      (!HasDestroy<node_alloc>::value ||
+       std::is_same_v<node_alloc, std::allocator<Node>>);
+
   template <bool IsConst = false>
   class BaseIterator {
    public:
@@ -52,32 +76,23 @@ class List {
     using pointer = typename std::conditional<IsConst, const T*, T*>::type;
     using iterator_category = typename std::bidirectional_iterator_tag;
     using difference_type = std::ptrdiff_t;
-    using fake_node_pointer =
+    using base_node_pointer =
         typename std::conditional<IsConst, const BaseNode*, BaseNode*>::type;
     using node_pointer =
         typename std::conditional<IsConst, const Node*, Node*>::type;
-    BaseIterator(node_pointer node, node_pointer head, node_pointer tail,
-                 fake_node_pointer fake)
-        : current_(node), head_(head), tail_(tail), fake_(fake) {}
-    BaseIterator(const BaseIterator& src)
-        : current_(src.current_),
-          tail_(src.tail_),
-          head_(src.head_),
-          fake_(src.fake_) {}
-
-    typename std::conditional<IsConst, const T&, T&>::type operator*() const {
-      return current_->value;
-    }
-    typename std::conditional<IsConst, const T*, T*>::type operator->() const {
-      return &(current_->value);
-    }
-    BaseIterator& operator=(const BaseIterator& src) {
-      BaseIterator copy = src;
-      std::swap(current_, copy.current_);
-      std::swap(head_, copy.head_);
-      std::swap(tail_, copy.tail_);
-      std::swap(fake_, copy.fake_);
-      return *this;
+
+    BaseIterator() = default;
+    explicit BaseIterator(base_node_pointer node) : current_(node) {}
+    template <bool OtherConst,
+              typename = std::enable_if_t<IsConst && !OtherConst>>
+    BaseIterator(const BaseIterator<OtherConst>& src)
+        : current_(src.current_) {}
+
+    reference operator*() const {
+      return static_cast<node_pointer>(current_)->value;
+    }
+    pointer operator->() const {
+      return &(static_cast<node_pointer>(current_)->value);
     }
     BaseIterator operator++(int) {
       BaseIterator prev = *this;
@@ -85,11 +100,11 @@ class List {
       return prev;
     }
     BaseIterator& operator--() {
-      current_ = static_cast<node_pointer>(current_->prev);
+      current_ = current_->prev;
       return *this;
     }
     BaseIterator& operator++() {
-      current_ = static_cast<node_pointer>(current_->next);
+      current_ = current_->next;
       return *this;
     }
     BaseIterator operator--(int) {
@@ -97,411 +112,470 @@ class List {
       --(*this);
       return prev;
     }
-    bool operator==(const BaseIterator& other) const {
+    // Templated on the other constness, so that iterators and
+    // const_iterators compare with each other.
+    template <bool OtherConst>
+    bool operator==(const BaseIterator<OtherConst>& other) const {
       return (current_ == other.current_);
     }
-    bool operator!=(const BaseIterator& other) const {
+    template <bool OtherConst>
+    bool operator!=(const BaseIterator<OtherConst>& other) const {
       return !(*this == other);
     }
 
    private:
-    node_pointer tail_;
-    node_pointer head_;
-    node_pointer current_;
-    fake_node_pointer fake_;
+    friend class List;
+    template <bool OtherConst>
+    friend class BaseIterator;
+
+    base_node_pointer current_ = nullptr;
   };
 
  public:
-  List() {
-    size_ = 0;
-    head_ = nullptr;
-    tail_ = nullptr;
-    fake_ = &fake_node_;
-  }
+  List() = default;
+  explicit List(const Allocator& alloc) : alloc_(alloc) {}
   explicit List(size_t count, const Allocator& alloc = allocator_type())
-      : alloc_(alloc) {
-    size_ = count;
-    Node* current = nullptr;
-    for (size_t i = 0; i < count; ++i) {
-      Node* temp;
-      temp = node_alloc_traits::allocate(alloc_, 1);
-      try {
-        node_alloc_traits::construct(alloc_, temp);
-      } catch (...) {
-        node_alloc_traits::deallocate(alloc_, temp, 1);
-        if (head_ != nullptr) {
-          Node* ptr = head_;
-          while (ptr != nullptr) {
-            head_ = static_cast<Node*>(head_->next);
-            node_alloc_traits::destroy(alloc_, ptr);
-            node_alloc_traits::deallocate(alloc_, ptr, 1);
-            ptr = head_;
-          }
-        }
-        throw;
-      }
-      temp->prev = current;
-      current = temp;
-      if (temp->prev != nullptr) {
-        temp->prev->next = current;
-      }
-      if (i == 0) {
-        head_ = temp;
-      } else if (i == size_ - 1) {
-        tail_ = temp;
-      }
-    }
-    fake_ = &fake_node_;
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
+      : List(alloc) {
+    append_count(count);
   }
   List(size_t count, const T& value,
        const allocator_type& alloc = allocator_type())
-      : alloc_(alloc) {
-    size_ = count;
-    Node* current = nullptr;
-    for (size_t i = 0; i < count; ++i) {
-      Node* temp;
-      try {
-        temp = node_alloc_traits::allocate(alloc_, 1);
-      } catch (const std::bad_alloc&) {
-        throw;
-      }
-      try {
-        node_alloc_traits::construct(alloc_, temp, value);
-      } catch (...) {
-        node_alloc_traits::deallocate(alloc_, temp, 1);
-        throw;
-      }
-      temp->prev = current;
-      // temp->value = value;
-      current = temp;
-      if (temp->prev != nullptr) {
-        temp->prev->next = current;
-      }
-      if (i == 0) {
-        head_ = temp;
-      } else if (i == count - 1) {
-        tail_ = temp;
-      }
-    }
-    fake_ = &fake_node_;
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
+      : List(alloc) {
+    append_count(count, value);
   }
-  List(const List& other)
-      : alloc_(node_alloc_traits::select_on_container_copy_construction(
-            other.alloc_)) {
-    size_ = other.size_;
-    Node* current = nullptr;
-    Node* other_current = other.head_;
-    for (size_t i = 0; i < size_; ++i) {
-      Node* temp = nullptr;
-      try {
-        temp = node_alloc_traits::allocate(alloc_, 1);
-      } catch (const std::bad_alloc&) {
-        throw;
-      }
-      try {
-        node_alloc_traits::construct(alloc_, temp, other_current->value);
-      } catch (...) {
-        node_alloc_traits::deallocate(alloc_, temp, 1);
-        Node* ptr = head_;
-        while (ptr != nullptr) {
-          head_ = static_cast<Node*>(head_->next);
-          node_alloc_traits::destroy(alloc_, ptr);
-          node_alloc_traits::deallocate(alloc_, ptr, 1);
-          ptr = head_;
-        }
-        throw;
-      }
-      temp->prev = current;
-      current = temp;
-      if (temp->prev != nullptr) {
-        temp->prev->next = current;
-      }
-      if (i == 0) {
-        head_ = temp;
-      } else if (i == size_ - 1) {
-        tail_ = temp;
-      }
-      other_current = static_cast<Node*>(other_current->next);
-    }
-    fake_ = &fake_node_;
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
+  template <typename InputIt, typename = RequireInputIterator<InputIt>>
+  List(InputIt first, InputIt last,
+       const allocator_type& alloc = allocator_type())
+      : List(alloc) {
+    append_range(first, last);
   }
+  List(const List& other)
+      : List(other, node_alloc_traits::select_on_container_copy_construction(
+                        other.alloc_)) {}
   List(std::initializer_list<T> init,
        const allocator_type& alloc = allocator_type())
-      : alloc_(alloc) {
-    size_ = init.size();
-    Node* current = nullptr;
-    for (auto it = init.begin(); it != init.end(); ++it) {
-      Node* temp;
-      try {
-        temp = node_alloc_traits::allocate(alloc_, 1);
-      } catch (const std::bad_alloc&) {
-        throw;
-      }
-      try {
-        node_alloc_traits::construct(alloc_, temp, *it);
-      } catch (...) {
-        node_alloc_traits::deallocate(alloc_, temp, 1);
-        Node* ptr = head_;
-        while (ptr != nullptr) {
-          head_ = static_cast<Node*>(head_->next);
-          node_alloc_traits::destroy(alloc_, ptr);
-          node_alloc_traits::deallocate(alloc_, ptr, 1);
-          ptr = head_;
-        }
-        throw;
-      }
-      temp->prev = current;
-      current = temp;
-      if (temp->prev != nullptr) {
-        temp->prev->next = current;
-      }
-      if (it == init.begin()) {
-        head_ = temp;
-      } else if (it == init.end() - 1) {
-        tail_ = temp;
-      }
-    }
-    fake_ = &fake_node_;
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
-  }
-  List(const List& other, const Allocator& alloc) : alloc_(alloc) {
-    size_ = other.size_;
-    Node* current = nullptr;
-    Node* other_current = other.head_;
-    for (size_t i = 0; i < size_; ++i) {
-      Node* temp = nullptr;
-      try {
-        temp = node_alloc_traits::allocate(alloc_, 1);
-      } catch (const std::bad_alloc&) {
-        throw;
-      }
-      try {
-        node_alloc_traits::construct(alloc_, temp, other_current->value);
-      } catch (...) {
-        node_alloc_traits::deallocate(alloc_, temp, 1);
-        Node* ptr = head_;
-        while (ptr != nullptr) {
-          head_ = static_cast<Node*>(head_->next);
-          node_alloc_traits::destroy(alloc_, ptr);
-          node_alloc_traits::deallocate(alloc_, ptr, 1);
-          ptr = head_;
-        }
-        throw;
-      }
-      temp->prev = current;
-      current = temp;
-      if (temp->prev != nullptr) {
-        temp->prev->next = current;
-      }
-      if (i == 0) {
-        head_ = temp;
-      } else if (i == size_ - 1) {
-        tail_ = temp;
+      : List(init.begin(), init.end(), alloc) {}
+  List(const List& other, const Allocator& alloc)
+      : List(other.begin(), other.end(), alloc) {}
+  List(List&& other) noexcept : alloc_(other.alloc_) { take_nodes(other); }
+  ~List() { destroy_all(); }
+  List& operator=(const List& other) {
+    if (this != &other) {
+      List copy(other,
+                alloc_traits::propagate_on_container_copy_assignment::value
+                    ? other.alloc_
+                    : alloc_);
+      clear();
+      if (alloc_traits::propagate_on_container_copy_assignment::value) {
+        alloc_ = other.alloc_;
       }
-      other_current = static_cast<Node*>(other_current->next);
+      take_nodes(copy);
     }
-    fake_ = &fake_node_;
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
+    return *this;
   }
-  ~List() {
-    Node* current = head_;
-    for (size_t i = 0; i < size_; ++i) {
-      current = head_;
-      head_ = static_cast<Node*>(head_->next);
-      node_alloc_traits::destroy(alloc_, current);
-      node_alloc_traits::deallocate(alloc_, current, 1);
+  List& operator=(List&& other) noexcept(
+      node_alloc_traits::propagate_on_container_move_assignment::value ||
+      node_alloc_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
     }
-  }
-  List& operator=(const List& other) {
-    if (this != &other) {
-      if (alloc_traits::propagate_on_container_copy_assignment::value) {
+    if (node_alloc_traits::propagate_on_container_move_assignment::value ||
+        alloc_ == other.alloc_) {
+      clear();
+      if (node_alloc_traits::propagate_on_container_move_assignment::value) {
         alloc_ = other.alloc_;
       }
-      List copy(other, alloc_);
-      std::swap(size_, copy.size_);
-      std::swap(head_, copy.head_);
-      std::swap(tail_, copy.tail_);
-      std::swap(fake_, copy.fake_);
+      take_nodes(other);
+      return *this;
     }
+    List moved(std::make_move_iterator(other.begin()),
+               std::make_move_iterator(other.end()), alloc_);
+    clear();
+    take_nodes(moved);
     return *this;
   }
 
-  T& front() { return head_->value; }
-  const T& front() const { return head_->value; }
-  T& back() { return tail_->value; }
-  const T& back() const { return tail_->value; };
-  bool empty() { return (size_ == 0); }
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *--end(); }
+  const T& back() const { return *--end(); };
+  bool empty() const { return (size_ == 0); }
 
   size_t size() const { return size_; }
-  void push_front(const T& value) {
-    size_++;
-    Node* temp = nullptr;
-    try {
-      temp = node_alloc_traits::allocate(alloc_, 1);
-    } catch (const std::bad_alloc&) {
-      throw;
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void pop_back() {
+    if (size_ == 0) {
+      return;
     }
-    try {
-      temp->value = value;
-    } catch (...) {
-      node_alloc_traits::deallocate(alloc_, temp, 1);
-      throw;
+    erase(--cend());
+  }
+  void pop_front() {
+    if (size_ == 0) {
+      return;
     }
-    temp->next = head_;
-    temp->prev = nullptr;
-    head_->prev = temp;
-    head_ = temp;
-    if (size_ == 1) {
-      tail_ = head_;
-    }
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
-  }
-  void push_back(const T& value) {
-    size_++;
-    Node* temp;
-    try {
-      temp = node_alloc_traits::allocate(alloc_, 1);
-    } catch (const std::bad_alloc&) {
-      throw;
+    erase(cbegin());
+  }
+
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(cbegin(), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(cend(), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    Node* node = create_node(std::forward<Args>(args)...);
+    link_before(node_of(pos), node, node);
+    ++size_;
+    return iterator(node);
+  }
+
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+  iterator insert(const_iterator pos, size_t count, const T& value) {
+    List inserted(count, value, alloc_);
+    return insert_nodes(pos, inserted);
+  }
+  template <typename InputIt, typename = RequireInputIterator<InputIt>>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    List inserted(first, last, alloc_);
+    return insert_nodes(pos, inserted);
+  }
+  iterator insert(const_iterator pos, std::initializer_list<T> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  iterator erase(const_iterator pos) {
+    BaseNode* node = node_of(pos);
+    BaseNode* next = node->next;
+    unlink(node, node);
+    destroy_node(static_cast<Node*>(node));
+    --size_;
+    return iterator(next);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
     }
-    try {
-      temp->value = value;
-    } catch (...) {
-      node_alloc_traits::deallocate(alloc_, temp, 1);
-      throw;
+    return iterator(node_of(last));
+  }
+  void clear() { destroy_all(); }
+
+  void splice(const_iterator pos, List& other) {
+    splice(pos, other, other.cbegin(), other.cend());
+  }
+  void splice(const_iterator pos, List&& other) { splice(pos, other); }
+  void splice(const_iterator pos, List& other, const_iterator it) {
+    if (pos == it) {
+      return;
     }
-    temp->prev = tail_;
-    temp->next = nullptr;
-    tail_->next = temp;
-    tail_ = temp;
-    if (size_ == 1) {
-      head_ = tail_;
-    }
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
-  }
-  void push_back(T&& value) {
-    size_++;
-    Node* temp;
-    try {
-      temp = node_alloc_traits::allocate(alloc_, 1);
-    } catch (const std::bad_alloc&) {
-      throw;
+    const_iterator last = it;
+    splice(pos, other, it, ++last);
+  }
+  void splice(const_iterator pos, List&& other, const_iterator it) {
+    splice(pos, other, it);
+  }
+  void splice(const_iterator pos, List& other, const_iterator first,
+              const_iterator last) {
+    if (first == last || pos == last) {
+      return;
     }
-    try {
-      temp->value = std::move(value);
-    } catch (...) {
-      node_alloc_traits::deallocate(alloc_, temp, 1);
-      throw;
+    if (this != &other) {
+      size_t count = static_cast<size_t>(std::distance(first, last));
+      other.size_ -= count;
+      size_ += count;
+    }
+    BaseNode* begin = node_of(first);
+    BaseNode* back = node_of(last)->prev;
+    unlink(begin, back);
+    link_before(node_of(pos), begin, back);
+  }
+  void splice(const_iterator pos, List&& other, const_iterator first,
+              const_iterator last) {
+    splice(pos, other, first, last);
+  }
+
+  void merge(List& other) { merge(other, std::less<T>()); }
+  void merge(List&& other) { merge(other); }
+  template <typename Compare>
+  void merge(List& other, Compare comp) {
+    if (this == &other || other.size_ == 0) {
+      return;
+    }
+    BaseNode* chain = merge_chains(detach(), other.detach(), comp);
+    size_ += other.size_;
+    other.size_ = 0;
+    attach(chain);
+  }
+  template <typename Compare>
+  void merge(List&& other, Compare comp) {
+    merge(other, comp);
+  }
+
+  void sort() { sort(std::less<T>()); }
+  // Bottom-up merge sort over the node chain: runs of 2^i nodes are kept in
+  // runs[i], nodes are relinked and values never move.
+  template <typename Compare>
+  void sort(Compare comp) {
+    if (size_ < 2) {
+      return;
     }
-    temp->prev = tail_;
-    temp->next = nullptr;
-    if (tail_ != nullptr) {
-      tail_->next = temp;
+    const size_t kMaxRuns = 64;
+    BaseNode* runs[kMaxRuns] = {};
+    BaseNode* chain = detach();
+    while (chain != nullptr) {
+      BaseNode* run = chain;
+      chain = chain->next;
+      run->next = nullptr;
+      size_t ind = 0;
+      for (; ind + 1 < kMaxRuns && runs[ind] != nullptr; ++ind) {
+        run = merge_chains(runs[ind], run, comp);
+        runs[ind] = nullptr;
+      }
+      runs[ind] = run;
     }
-    tail_ = temp;
-    if (size_ == 1) {
-      head_ = tail_;
+    for (size_t ind = 0; ind < kMaxRuns; ++ind) {
+      if (runs[ind] != nullptr) {
+        chain = merge_chains(runs[ind], chain, comp);
+      }
     }
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
+    attach(chain);
   }
-  void push_front(T&& value) {
-    size_++;
-    Node* temp = nullptr;
-    try {
-      temp = node_alloc_traits::allocate(alloc_, 1);
-    } catch (const std::bad_alloc&) {
-      throw;
+
+  void reverse() {
+    BaseNode* current = &fake_node_;
+    do {
+      std::swap(current->next, current->prev);
+      current = current->prev;
+    } while (current != &fake_node_);
+  }
+
+  size_t unique() { return unique(std::equal_to<T>()); }
+  template <typename BinaryPredicate>
+  size_t unique(BinaryPredicate pred) {
+    size_t removed = 0;
+    BaseNode* current = fake_node_.next;
+    while (current != &fake_node_ && current->next != &fake_node_) {
+      BaseNode* next = current->next;
+      if (pred(static_cast<Node*>(current)->value,
+               static_cast<Node*>(next)->value)) {
+        unlink(next, next);
+        destroy_node(static_cast<Node*>(next));
+        --size_;
+        ++removed;
+      } else {
+        current = next;
+      }
     }
+    return removed;
+  }
+
+  allocator_type get_allocator() const { return alloc_; }
+  iterator begin() { return iterator(fake_node_.next); }
+  const_iterator begin() const { return const_iterator(fake_node_.next); }
+  iterator end() { return iterator(&fake_node_); }
+  const_iterator end() const { return const_iterator(&fake_node_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crend() const {
+    return const_reverse_iterator(cbegin());
+  }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator crbegin() const {
+    return const_reverse_iterator(cend());
+  }
+
+ private:
+  template <bool IsConst>
+  static BaseNode* node_of(const BaseIterator<IsConst>& it) {
+    return const_cast<BaseNode*>(it.current_);
+  }
+
+  static void unlink(BaseNode* first, BaseNode* last) {
+    first->prev->next = last->next;
+    last->next->prev = first->prev;
+  }
+
+  static void link_before(BaseNode* pos, BaseNode* first, BaseNode* last) {
+    first->prev = pos->prev;
+    last->next = pos;
+    pos->prev->next = first;
+    pos->prev = last;
+  }
+
+  // Takes all nodes out of the ring as a null-terminated chain linked through
+  // next only. size_ is left untouched.
+  BaseNode* detach() {
+    if (size_ == 0) {
+      return nullptr;
+    }
+    BaseNode* chain = fake_node_.next;
+    fake_node_.prev->next = nullptr;
+    fake_node_.next = &fake_node_;
+    fake_node_.prev = &fake_node_;
+    return chain;
+  }
+
+  // Puts a chain of size_ nodes back into the ring, restoring prev links.
+  void attach(BaseNode* chain) {
+    BaseNode* prev = &fake_node_;
+    for (BaseNode* current = chain; current != nullptr;
+         current = current->next) {
+      current->prev = prev;
+      prev->next = current;
+      prev = current;
+    }
+    prev->next = &fake_node_;
+    fake_node_.prev = prev;
+  }
+
+  // Stable: on equal values the nodes of first go before those of second.
+  template <typename Compare>
+  static BaseNode* merge_chains(BaseNode* first, BaseNode* second,
+                                Compare& comp) {
+    BaseNode head;
+    BaseNode* last = &head;
+    while (first != nullptr && second != nullptr) {
+      if (comp(static_cast<Node*>(second)->value,
+               static_cast<Node*>(first)->value)) {
+        last->next = second;
+        second = second->next;
+      } else {
+        last->next = first;
+        first = first->next;
+      }
+      last = last->next;
+    }
+    last->next = (first != nullptr) ? first : second;
+    return head.next;
+  }
+
+  // Steals all nodes of other in O(1), re-pointing the ends of its ring at
+  // our own fake node. The list must be empty.
+  void take_nodes(List& other) {
+    if (other.size_ == 0) {
+      return;
+    }
+    size_ = other.size_;
+    fake_node_.next = other.fake_node_.next;
+    fake_node_.prev = other.fake_node_.prev;
+    fake_node_.next->prev = &fake_node_;
+    fake_node_.prev->next = &fake_node_;
+    other.size_ = 0;
+    other.fake_node_.next = &other.fake_node_;
+    other.fake_node_.prev = &other.fake_node_;
+  }
+
+  template <typename... Args>
+  Node* create_node(Args&&... args) {
+    Node* node = node_alloc_traits::allocate(alloc_, 1);
     try {
-      temp->value = std::move(value);
+      node_alloc_traits::construct(alloc_, node, std::forward<Args>(args)...);
     } catch (...) {
-      node_alloc_traits::deallocate(alloc_, temp, 1);
+      node_alloc_traits::deallocate(alloc_, node, 1);
       throw;
     }
-    temp->next = head_;
-    temp->prev = nullptr;
-    if (head_ != nullptr) {
-      head_->prev = temp;
-    }
-    head_ = temp;
-    if (size_ == 1) {
-      tail_ = head_;
-    }
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
+    return node;
   }
-  void pop_back() {
-    if (size_ == 0) {
-      return;
+
+  void reserve_nodes(size_t count) {
+    if constexpr (HasReserve<node_alloc>::value) {
+      alloc_.reserve(count);
     }
-    size_--;
-    Node* temp = tail_;
-    tail_ = static_cast<Node*>(tail_->prev);
-    tail_->next = nullptr;
-    node_alloc_traits::destroy(alloc_, temp);
-    node_alloc_traits::deallocate(alloc_, temp, 1);
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
   }
-  void pop_front() {
-    if (size_ == 0) {
-      return;
+
+  // Links the nodes returned by make() after the last element until it
+  // returns nullptr. The ring is closed once at the end, or when make()
+  // throws, so the destructor can clean up a half-built list.
+  template <typename Make>
+  void append_nodes(Make make) {
+    BaseNode* last = fake_node_.prev;
+    try {
+      while (Node* node = make()) {
+        last->next = node;
+        node->prev = last;
+        last = node;
+        ++size_;
+      }
+    } catch (...) {
+      last->next = &fake_node_;
+      fake_node_.prev = last;
+      throw;
     }
-    size_--;
-    Node* temp = head_;
-    head_ = static_cast<Node*>(head_->next);
-    head_->prev = nullptr;
-    node_alloc_traits::destroy(alloc_, temp);
-    node_alloc_traits::deallocate(alloc_, temp, 1);
-    head_->prev = fake_;
-    tail_->next = fake_;
-    fake_->next = head_;
-    fake_->prev = tail_;
-  }
-  allocator_type get_allocator() { return alloc_; }
-  iterator begin() const { return iterator(head_, head_, tail_, fake_); };
-  iterator end() const { return ++iterator(tail_, head_, tail_, fake_); }
-  const_iterator cbegin() const {
-    return const_iterator(head_, head_, tail_, fake_);
-  }
-  const_iterator cend() const { return ++iterator(tail_, head_, tail_, fake_); }
-  reverse_iterator rend() const { return reverse_iterator(begin()); }
-  const_reverse_iterator crend() const {
-    return const_reverse_iterator(cbegin());
+    last->next = &fake_node_;
+    fake_node_.prev = last;
   }
-  reverse_iterator rbegin() const { return reverse_iterator(end()); }
-  const_reverse_iterator crbegin() const {
-    return const_reverse_iterator(cend());
+
+  template <typename... Args>
+  void append_count(size_t count, const Args&... args) {
+    reserve_nodes(count);
+    append_nodes([&]() -> Node* {
+      if (count == 0) {
+        return nullptr;
+      }
+      --count;
+      return create_node(args...);
+    });
+  }
+
+  template <typename InputIt>
+  void append_range(InputIt first, InputIt last) {
+    if constexpr (std::is_convertible_v<
+                      typename std::iterator_traits<InputIt>::iterator_category,
+                      std::forward_iterator_tag>) {
+      reserve_nodes(static_cast<size_t>(std::distance(first, last)));
+    }
+    append_nodes([&]() -> Node* {
+      if (first == last) {
+        return nullptr;
+      }
+      Node* node = create_node(*first);
+      ++first;
+      return node;
+    });
+  }
+
+  // Frees every node in one walk without relinking the ring node by node.
+  void destroy_all() {
+    BaseNode* current = fake_node_.next;
+    while (current != &fake_node_) {
+      BaseNode* next = current->next;
+      destroy_node(static_cast<Node*>(current));
+      current = next;
+    }
+    fake_node_.next = &fake_node_;
+    fake_node_.prev = &fake_node_;
+    size_ = 0;
+  }
+
+  // Moves all nodes of a freshly built list before pos, returns an iterator
+  // to the first of them (or pos if there were none).
+  iterator insert_nodes(const_iterator pos, List& inserted) {
+    BaseNode* first = inserted.fake_node_.next;
+    splice(pos, inserted);
+    return iterator(first == &inserted.fake_node_ ? node_of(pos) : first);
+  }
+
+  void destroy_node(Node* node) {
+    if constexpr (!kTrivialDestroy) {
+      node_alloc_traits::destroy(alloc_, node);
+    }
+    node_alloc_traits::deallocate(alloc_, node, 1);
   }
-};
\ No newline at end of file
+};
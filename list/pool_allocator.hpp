@@ -0,0 +1,171 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace node_pool {
+// Fixed-size slots carved from large slabs, recycled through a free list.
+class Pool {
+ public:
+  // slot_size must be a multiple of align and fit a free-list link.
+  Pool(size_t slot_size, size_t align)
+      : slot_size_(slot_size), align_(align) {}
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+  ~Pool() {
+    for (char* slab : slabs_) {
+      ::operator delete(slab, std::align_val_t(align_));
+    }
+  }
+
+  size_t slot_size() const { return slot_size_; }
+  size_t align() const { return align_; }
+
+  void* acquire(size_t slab_size) {
+    if (free_list_ != nullptr) {
+      Slot* slot = free_list_;
+      free_list_ = slot->next;
+      --free_count_;
+      return slot;
+    }
+    if (current_ == end_) {
+      add_slab(slab_size);
+    }
+    void* result = current_;
+    current_ += slot_size_;
+    return result;
+  }
+
+  void release(void* ptr) {
+    Slot* slot = static_cast<Slot*>(ptr);
+    slot->next = free_list_;
+    free_list_ = slot;
+    ++free_count_;
+  }
+
+  void reserve(size_t count, size_t slab_size) {
+    size_t available =
+        free_count_ + static_cast<size_t>(end_ - current_) / slot_size_;
+    if (available < count) {
+      add_slab(std::max(count - available, slab_size));
+    }
+  }
+
+ private:
+  struct Slot {
+    Slot* next;
+  };
+
+  void add_slab(size_t slots) {
+    slabs_.reserve(slabs_.size() + 1);
+    char* slab = static_cast<char*>(
+        ::operator new(slots * slot_size_, std::align_val_t(align_)));
+    slabs_.push_back(slab);
+    while (current_ != end_) {
+      release(current_);
+      current_ += slot_size_;
+    }
+    current_ = slab;
+    end_ = slab + slots * slot_size_;
+  }
+
+  size_t slot_size_;
+  size_t align_;
+  std::vector<char*> slabs_;
+  Slot* free_list_ = nullptr;
+  size_t free_count_ = 0;
+  char* current_ = nullptr;
+  char* end_ = nullptr;
+};
+
+// One pool per slot size, shared by an allocator and all of its rebinds.
+class PoolSet {
+ public:
+  Pool* get(size_t size, size_t align) {
+    align = std::max(align, alignof(void*));
+    size_t slot_size =
+        (std::max(size, sizeof(void*)) + align - 1) / align * align;
+    for (auto& pool : pools_) {
+      if (pool->slot_size() == slot_size && pool->align() == align) {
+        return pool.get();
+      }
+    }
+    pools_.push_back(std::make_unique<Pool>(slot_size, align));
+    return pools_.back().get();
+  }
+
+ private:
+  std::vector<std::unique_ptr<Pool>> pools_;
+};
+};  // namespace node_pool
+
+// Slab allocator for node-based containers: single-object requests are served
+// from a node_pool::Pool, everything else goes to operator new. Copies and
+// rebinds share the pools, slabs are released together with the last copy.
+// The pools are not synchronized, so containers whose allocators are copies
+// of one another must not be used from several threads at once.
+template <typename T, size_t kSlabSize = 256>
+class PoolAllocator {
+ private:
+  template <typename U, size_t kOtherSlabSize>
+  friend class PoolAllocator;
+
+  std::shared_ptr<node_pool::PoolSet> pools_;
+  node_pool::Pool* pool_;
+
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  template <typename U>
+  struct rebind {
+    using other = PoolAllocator<U, kSlabSize>;
+  };
+
+  PoolAllocator()
+      : pools_(std::make_shared<node_pool::PoolSet>()),
+        pool_(pools_->get(sizeof(T), alignof(T))) {}
+
+  // Moving copies: a moved-from allocator must stay equal to its source and
+  // keep its share of the pools it may still allocate from.
+  PoolAllocator(const PoolAllocator&) = default;
+  PoolAllocator& operator=(const PoolAllocator&) = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U, kSlabSize>& other)
+      : pools_(other.pools_), pool_(pools_->get(sizeof(T), alignof(T))) {}
+
+  T* allocate(size_t count) {
+    if (count == 1) {
+      return static_cast<T*>(pool_->acquire(kSlabSize));
+    }
+    return static_cast<T*>(
+        ::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    if (count == 1) {
+      pool_->release(ptr);
+      return;
+    }
+    ::operator delete(ptr, std::align_val_t(alignof(T)));
+  }
+
+  // Makes sure the next count single-object allocations need no new slab.
+  void reserve(size_t count) { pool_->reserve(count, kSlabSize); }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U, kSlabSize>& other) const {
+    return pools_ == other.pools_;
+  }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U, kSlabSize>& other) const {
+    return !(*this == other);
+  }
+};
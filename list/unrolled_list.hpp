@@ -0,0 +1,476 @@
+#pragma once
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Doubly linked list of chunks, each holding up to kChunkCapacity elements
+// stored contiguously. Full chunks are split in half on insertion, a chunk
+// that drops below half is merged with its successor when they fit together.
+template <typename T, typename Allocator = std::allocator<T>,
+          size_t kChunkCapacity = std::max<size_t>(4, 256 / sizeof(T))>
+class UnrolledList {
+ private:
+  template <bool IsConst>
+  class BaseIterator;
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  using reference = value_type&;
+  using const_reference = value_type const&;
+  using pointer = value_type*;
+  using const_pointer = value_type const*;
+  using iterator = BaseIterator<false>;
+  using const_iterator = BaseIterator<true>;
+  using difference_type = std::ptrdiff_t;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+ private:
+  static_assert(kChunkCapacity >= 2, "a chunk must be able to split");
+  // Splits, merges and erase() shift elements between and within chunks
+  // and cannot undo a move that throws halfway.
+  static_assert(std::is_nothrow_move_constructible_v<T> &&
+                    std::is_nothrow_move_assignable_v<T>,
+                "T must be nothrow movable");
+
+  struct BaseNode {
+    BaseNode* next = nullptr;
+    BaseNode* prev = nullptr;
+    size_t count = 0;
+  };
+  struct Chunk : public BaseNode {
+    // User-provided, so that value-initialisation through the allocator
+    // leaves storage alone instead of zero-filling it.
+    Chunk() {}
+
+    alignas(T) unsigned char storage[kChunkCapacity * sizeof(T)];
+
+    T* data() { return std::launder(reinterpret_cast<T*>(storage)); }
+    const T* data() const {
+      return std::launder(reinterpret_cast<const T*>(storage));
+    }
+  };
+
+  size_t size_ = 0;
+  // Ring of chunks through fake_node_, which has count 0 and serves as end().
+  // Chunks in the ring are never empty.
+  BaseNode fake_node_{&fake_node_, &fake_node_, 0};
+  using alloc_traits = std::allocator_traits<allocator_type>;
+  using chunk_alloc = typename alloc_traits::template rebind_alloc<Chunk>;
+  using chunk_alloc_traits =
+      typename alloc_traits::template rebind_traits<Chunk>;
+  chunk_alloc alloc_;
+
+  template <typename InputIt>
+  using RequireInputIterator = std::enable_if_t<std::is_convertible_v<
+      typename std::iterator_traits<InputIt>::iterator_category,
+      std::input_iterator_tag>>;
+
+  template <bool IsConst = false>
+  class BaseIterator {
+   public:
+    using value_type = typename std::conditional<IsConst, const T, T>::type;
+    using reference = typename std::conditional<IsConst, const T&, T&>::type;
+    using pointer = typename std::conditional<IsConst, const T*, T*>::type;
+    using iterator_category = typename std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using base_node_pointer =
+        typename std::conditional<IsConst, const BaseNode*, BaseNode*>::type;
+    using chunk_pointer =
+        typename std::conditional<IsConst, const Chunk*, Chunk*>::type;
+
+    BaseIterator() = default;
+    BaseIterator(base_node_pointer chunk, size_t index)
+        : chunk_(chunk), index_(index) {}
+    template <bool OtherConst,
+              typename = std::enable_if_t<IsConst && !OtherConst>>
+    BaseIterator(const BaseIterator<OtherConst>& src)
+        : chunk_(src.chunk_), index_(src.index_) {}
+
+    reference operator*() const {
+      return static_cast<chunk_pointer>(chunk_)->data()[index_];
+    }
+    pointer operator->() const {
+      return static_cast<chunk_pointer>(chunk_)->data() + index_;
+    }
+    BaseIterator& operator++() {
+      if (++index_ >= chunk_->count) {
+        chunk_ = chunk_->next;
+        index_ = 0;
+      }
+      return *this;
+    }
+    BaseIterator operator++(int) {
+      BaseIterator prev = *this;
+      ++(*this);
+      return prev;
+    }
+    BaseIterator& operator--() {
+      if (index_ == 0) {
+        chunk_ = chunk_->prev;
+        index_ = chunk_->count;
+      }
+      --index_;
+      return *this;
+    }
+    BaseIterator operator--(int) {
+      BaseIterator prev = *this;
+      --(*this);
+      return prev;
+    }
+    // Templated on the other constness, so that iterators and
+    // const_iterators compare with each other.
+    template <bool OtherConst>
+    bool operator==(const BaseIterator<OtherConst>& other) const {
+      return chunk_ == other.chunk_ && index_ == other.index_;
+    }
+    template <bool OtherConst>
+    bool operator!=(const BaseIterator<OtherConst>& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class UnrolledList;
+    template <bool OtherConst>
+    friend class BaseIterator;
+
+    base_node_pointer chunk_ = nullptr;
+    size_t index_ = 0;
+  };
+
+ public:
+  UnrolledList() = default;
+  explicit UnrolledList(const Allocator& alloc) : alloc_(alloc) {}
+  explicit UnrolledList(size_t count, const Allocator& alloc = Allocator())
+      : UnrolledList(alloc) {
+    for (size_t i = 0; i < count; ++i) {
+      emplace_back();
+    }
+  }
+  UnrolledList(size_t count, const T& value,
+               const Allocator& alloc = Allocator())
+      : UnrolledList(alloc) {
+    for (size_t i = 0; i < count; ++i) {
+      emplace_back(value);
+    }
+  }
+  template <typename InputIt, typename = RequireInputIterator<InputIt>>
+  UnrolledList(InputIt first, InputIt last,
+               const Allocator& alloc = Allocator())
+      : UnrolledList(alloc) {
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+  UnrolledList(std::initializer_list<T> init,
+               const Allocator& alloc = Allocator())
+      : UnrolledList(init.begin(), init.end(), alloc) {}
+  UnrolledList(const UnrolledList& other)
+      : UnrolledList(
+            other, chunk_alloc_traits::select_on_container_copy_construction(
+                       other.alloc_)) {}
+  UnrolledList(const UnrolledList& other, const Allocator& alloc)
+      : UnrolledList(other.begin(), other.end(), alloc) {}
+  UnrolledList(UnrolledList&& other) noexcept : alloc_(other.alloc_) {
+    take_chunks(other);
+  }
+  ~UnrolledList() { clear(); }
+
+  UnrolledList& operator=(const UnrolledList& other) {
+    if (this != &other) {
+      UnrolledList copy(
+          other, alloc_traits::propagate_on_container_copy_assignment::value
+                     ? other.alloc_
+                     : alloc_);
+      clear();
+      if (alloc_traits::propagate_on_container_copy_assignment::value) {
+        alloc_ = other.alloc_;
+      }
+      take_chunks(copy);
+    }
+    return *this;
+  }
+  UnrolledList& operator=(UnrolledList&& other) noexcept(
+      chunk_alloc_traits::propagate_on_container_move_assignment::value ||
+      chunk_alloc_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    if (chunk_alloc_traits::propagate_on_container_move_assignment::value ||
+        alloc_ == other.alloc_) {
+      clear();
+      if (chunk_alloc_traits::propagate_on_container_move_assignment::value) {
+        alloc_ = other.alloc_;
+      }
+      take_chunks(other);
+      return *this;
+    }
+    UnrolledList moved(std::make_move_iterator(other.begin()),
+                       std::make_move_iterator(other.end()), alloc_);
+    clear();
+    take_chunks(moved);
+    return *this;
+  }
+
+  T& front() { return *begin(); }
+  const T& front() const { return *begin(); }
+  T& back() { return *--end(); }
+  const T& back() const { return *--end(); }
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void pop_back() {
+    if (size_ != 0) {
+      erase(--cend());
+    }
+  }
+  void pop_front() {
+    if (size_ != 0) {
+      erase(cbegin());
+    }
+  }
+
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(cbegin(), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(cend(), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    BaseNode* node = const_cast<BaseNode*>(pos.chunk_);
+    size_t index = pos.index_;
+    if (node == &fake_node_) {
+      node = fake_node_.prev;
+      index = node->count;
+    }
+    Chunk* fresh = nullptr;
+    if (node == &fake_node_) {
+      fresh = create_chunk(&fake_node_);
+      node = fresh;
+    } else if (node->count == kChunkCapacity) {
+      if (index == kChunkCapacity) {
+        if (node->next != &fake_node_ && node->next->count < kChunkCapacity) {
+          node = node->next;
+        } else {
+          fresh = create_chunk(node->next);
+          node = fresh;
+        }
+        index = 0;
+      } else if (index == 0) {
+        if (node->prev != &fake_node_ && node->prev->count < kChunkCapacity) {
+          node = node->prev;
+          index = node->count;
+        } else {
+          fresh = create_chunk(node);
+          node = fresh;
+        }
+      } else {
+        split(static_cast<Chunk*>(node));
+        if (index > node->count) {
+          index -= node->count;
+          node = node->next;
+        }
+      }
+    }
+    Chunk* chunk = static_cast<Chunk*>(node);
+    T* data = chunk->data();
+    try {
+      chunk_alloc_traits::construct(alloc_, data + chunk->count,
+                                    std::forward<Args>(args)...);
+    } catch (...) {
+      if (fresh != nullptr) {
+        destroy_chunk(fresh);
+      }
+      throw;
+    }
+    ++chunk->count;
+    std::rotate(data + index, data + chunk->count - 1, data + chunk->count);
+    ++size_;
+    return iterator(chunk, index);
+  }
+
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+  iterator insert(const_iterator pos, size_t count, const T& value) {
+    UnrolledList inserted(count, value, alloc_);
+    return insert_moved(pos, inserted);
+  }
+  template <typename InputIt, typename = RequireInputIterator<InputIt>>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    UnrolledList inserted(first, last, alloc_);
+    return insert_moved(pos, inserted);
+  }
+  iterator insert(const_iterator pos, std::initializer_list<T> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  iterator erase(const_iterator pos) {
+    Chunk* chunk = static_cast<Chunk*>(const_cast<BaseNode*>(pos.chunk_));
+    size_t index = pos.index_;
+    T* data = chunk->data();
+    std::move(data + index + 1, data + chunk->count, data + index);
+    chunk_alloc_traits::destroy(alloc_, data + chunk->count - 1);
+    --chunk->count;
+    --size_;
+    if (chunk->count == 0) {
+      BaseNode* next = chunk->next;
+      destroy_chunk(chunk);
+      return iterator(next, 0);
+    }
+    BaseNode* next = chunk->next;
+    if (chunk->count < kChunkCapacity / 2 && next != &fake_node_ &&
+        chunk->count + next->count <= kChunkCapacity) {
+      absorb_next(chunk);
+    }
+    if (index < chunk->count) {
+      return iterator(chunk, index);
+    }
+    return iterator(chunk->next, 0);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    if (first == last) {
+      return iterator(const_cast<BaseNode*>(last.chunk_), last.index_);
+    }
+    // Positions shift while erasing, so count first and erase one by one.
+    size_t count = static_cast<size_t>(std::distance(first, last));
+    iterator current(const_cast<BaseNode*>(first.chunk_), first.index_);
+    for (size_t i = 0; i < count; ++i) {
+      current = erase(current);
+    }
+    return current;
+  }
+
+  void clear() {
+    BaseNode* current = fake_node_.next;
+    while (current != &fake_node_) {
+      BaseNode* next = current->next;
+      Chunk* chunk = static_cast<Chunk*>(current);
+      for (size_t i = 0; i < chunk->count; ++i) {
+        chunk_alloc_traits::destroy(alloc_, chunk->data() + i);
+      }
+      chunk_alloc_traits::destroy(alloc_, chunk);
+      chunk_alloc_traits::deallocate(alloc_, chunk, 1);
+      current = next;
+    }
+    fake_node_.next = &fake_node_;
+    fake_node_.prev = &fake_node_;
+    size_ = 0;
+  }
+
+  allocator_type get_allocator() const { return alloc_; }
+  iterator begin() { return iterator(fake_node_.next, 0); }
+  const_iterator begin() const { return const_iterator(fake_node_.next, 0); }
+  iterator end() { return iterator(&fake_node_, 0); }
+  const_iterator end() const { return const_iterator(&fake_node_, 0); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+
+ private:
+  // Allocates an empty chunk and links it in front of pos.
+  Chunk* create_chunk(BaseNode* pos) {
+    Chunk* chunk = chunk_alloc_traits::allocate(alloc_, 1);
+    try {
+      chunk_alloc_traits::construct(alloc_, chunk);
+    } catch (...) {
+      chunk_alloc_traits::deallocate(alloc_, chunk, 1);
+      throw;
+    }
+    chunk->prev = pos->prev;
+    chunk->next = pos;
+    pos->prev->next = chunk;
+    pos->prev = chunk;
+    return chunk;
+  }
+
+  // Unlinks and frees a chunk whose elements are already destroyed.
+  void destroy_chunk(Chunk* chunk) {
+    chunk->prev->next = chunk->next;
+    chunk->next->prev = chunk->prev;
+    chunk_alloc_traits::destroy(alloc_, chunk);
+    chunk_alloc_traits::deallocate(alloc_, chunk, 1);
+  }
+
+  // Moves the elements of inserted in front of pos. Only a chunk
+  // allocation can throw, and then the elements moved in so far are erased.
+  iterator insert_moved(const_iterator pos, UnrolledList& inserted) {
+    size_t count = 0;
+    try {
+      for (T& value : inserted) {
+        pos = std::next(emplace(pos, std::move(value)));
+        ++count;
+      }
+    } catch (...) {
+      for (; count != 0; --count) {
+        pos = erase(std::prev(pos));
+      }
+      throw;
+    }
+    iterator after(const_cast<BaseNode*>(pos.chunk_), pos.index_);
+    return std::prev(after, static_cast<std::ptrdiff_t>(count));
+  }
+
+  // Moves the upper half of a full chunk into a new chunk right after it.
+  void split(Chunk* chunk) {
+    Chunk* upper = create_chunk(chunk->next);
+    size_t half = chunk->count / 2;
+    relocate(chunk, half, chunk->count - half, upper);
+  }
+
+  void absorb_next(Chunk* chunk) {
+    Chunk* next = static_cast<Chunk*>(chunk->next);
+    relocate(next, 0, next->count, chunk);
+    destroy_chunk(next);
+  }
+
+  // Moves the tail of from, starting at from[first], to the end of to.
+  void relocate(Chunk* from, size_t first, size_t count, Chunk* to) {
+    T* source = from->data() + first;
+    T* target = to->data() + to->count;
+    for (size_t i = 0; i < count; ++i) {
+      chunk_alloc_traits::construct(alloc_, target + i, std::move(source[i]));
+      chunk_alloc_traits::destroy(alloc_, source + i);
+    }
+    from->count -= count;
+    to->count += count;
+  }
+
+  void take_chunks(UnrolledList& other) {
+    if (other.size_ == 0) {
+      return;
+    }
+    size_ = other.size_;
+    fake_node_.next = other.fake_node_.next;
+    fake_node_.prev = other.fake_node_.prev;
+    fake_node_.next->prev = &fake_node_;
+    fake_node_.prev->next = &fake_node_;
+    other.size_ = 0;
+    other.fake_node_.next = &other.fake_node_;
+    other.fake_node_.prev = &other.fake_node_;
+  }
+};
@@ -0,0 +1,192 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#include "smart_pointers.hpp"
+
+// SharedPtr<T> that can be loaded and replaced concurrently. A load is a
+// fetch_add on one word plus the increment on the object's control block, so
+// readers never wait for writers or for each other.
+//
+// The word holds a pointer to an immutable Snapshot in its high 48 bits and
+// the number of loads in flight on that snapshot in its low 16 bits (split
+// reference counting). A load bumps the local count, copies the SharedPtr out
+// and takes its increment back. If a writer swapped the snapshot out in the
+// meantime, the writer moved the local count into the snapshot's own count
+// and the reader settles there instead; the last one frees the snapshot.
+// Requires 48-bit user-space addresses, which is checked, and fewer than
+// 65536 concurrent loads.
+template <typename T>
+class AtomicSharedPtr {
+ private:
+  struct Snapshot {
+    explicit Snapshot(SharedPtr<T> value) : value(std::move(value)) {}
+
+    SharedPtr<T> value;
+    // Holds still outstanding once the snapshot is no longer installed.
+    // Readers may settle before the writer does, so it can dip below zero;
+    // it only reaches zero when every hold has been given back.
+    std::atomic<int64_t> refs{0};
+  };
+
+  static_assert(sizeof(uintptr_t) == 8, "needs 64-bit pointers");
+  static constexpr int kCountBits = 16;
+  static constexpr uintptr_t kCountMask = (uintptr_t(1) << kCountBits) - 1;
+
+ public:
+  AtomicSharedPtr() : word_(0) {}
+  AtomicSharedPtr(SharedPtr<T> value) : word_(make_word(std::move(value))) {}
+  AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+  AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+  ~AtomicSharedPtr() { retire(word_.load(std::memory_order_acquire)); }
+
+  AtomicSharedPtr& operator=(SharedPtr<T> desired) {
+    store(std::move(desired));
+    return *this;
+  }
+  operator SharedPtr<T>() const { return load(); }
+
+  bool is_lock_free() const { return word_.is_lock_free(); }
+
+  SharedPtr<T> load() const {
+    Snapshot* snapshot = acquire();
+    SharedPtr<T> result;
+    if (snapshot != nullptr) {
+      result = snapshot->value;
+    }
+    release(snapshot);
+    return result;
+  }
+
+  void store(SharedPtr<T> desired) {
+    retire(word_.exchange(make_word(std::move(desired)),
+                          std::memory_order_acq_rel));
+  }
+
+  SharedPtr<T> exchange(SharedPtr<T> desired) {
+    uintptr_t old = word_.exchange(make_word(std::move(desired)),
+                                   std::memory_order_acq_rel);
+    SharedPtr<T> result;
+    if (Snapshot* snapshot = snapshot_of(old)) {
+      result = snapshot->value;
+    }
+    retire(old);
+    return result;
+  }
+
+  // Replaces the value with desired if it still shares ownership with
+  // expected and points to the same object; otherwise loads it into
+  // expected.
+  bool compare_exchange_strong(SharedPtr<T>& expected,
+                               SharedPtr<T> desired) {
+    // The snapshot for desired is only made once expected has matched, and
+    // then kept across retries.
+    uintptr_t desired_word = 0;
+    bool made = false;
+    while (true) {
+      Snapshot* snapshot = acquire();
+      if (!holds(snapshot, expected)) {
+        expected = snapshot != nullptr ? snapshot->value : SharedPtr<T>();
+        release(snapshot);
+        retire(desired_word);
+        return false;
+      }
+      if (!made) {
+        release(snapshot);
+        desired_word = make_word(std::move(desired));
+        made = true;
+        continue;
+      }
+      uintptr_t word = word_.load(std::memory_order_relaxed);
+      while (snapshot_of(word) == snapshot) {
+        if (word_.compare_exchange_weak(word, desired_word,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_relaxed)) {
+          // Our own hold is part of the count being retired.
+          if (snapshot != nullptr) {
+            settle(snapshot, count_of(word) - 1);
+          }
+          return true;
+        }
+      }
+      release(snapshot);
+    }
+  }
+
+  bool compare_exchange_weak(SharedPtr<T>& expected, SharedPtr<T> desired) {
+    return compare_exchange_strong(expected, std::move(desired));
+  }
+
+ private:
+  // Throws std::overflow_error if the snapshot was allocated above 2^48,
+  // where its address would run into the count.
+  static uintptr_t make_word(SharedPtr<T> value) {
+    if (value.control_block_ == nullptr) {
+      return 0;
+    }
+    Snapshot* snapshot = new Snapshot(std::move(value));
+    uintptr_t address = reinterpret_cast<uintptr_t>(snapshot);
+    if (address >> (64 - kCountBits) != 0) {
+      delete snapshot;
+      throw std::overflow_error("snapshot address exceeds 48 bits");
+    }
+    return address << kCountBits;
+  }
+
+  static Snapshot* snapshot_of(uintptr_t word) {
+    return reinterpret_cast<Snapshot*>(word >> kCountBits);
+  }
+
+  static int64_t count_of(uintptr_t word) {
+    return static_cast<int64_t>(word & kCountMask);
+  }
+
+  static bool holds(const Snapshot* snapshot, const SharedPtr<T>& value) {
+    if (snapshot == nullptr) {
+      return value.control_block_ == nullptr;
+    }
+    return snapshot->value.ptr_ == value.ptr_ &&
+           snapshot->value.control_block_ == value.control_block_;
+  }
+
+  // Takes a hold on the installed snapshot, which keeps it alive.
+  Snapshot* acquire() const {
+    return snapshot_of(word_.fetch_add(1, std::memory_order_acquire));
+  }
+
+  // Gives back a hold taken by acquire(). A snapshot is never reinstalled,
+  // so an unchanged pointer means our increment is still in the word. An
+  // empty word can come back after a round trip, hence the zero check:
+  // the increment of an empty word may have been dropped by a writer.
+  void release(Snapshot* snapshot) const {
+    uintptr_t word = word_.load(std::memory_order_relaxed);
+    while (snapshot_of(word) == snapshot && count_of(word) != 0) {
+      if (word_.compare_exchange_weak(word, word - 1,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+        return;
+      }
+    }
+    if (snapshot != nullptr && snapshot_of(word) != snapshot) {
+      settle(snapshot, -1);
+    }
+  }
+
+  // Moves the in-flight count of a word just taken out of word_ onto its
+  // snapshot.
+  static void retire(uintptr_t word) {
+    if (Snapshot* snapshot = snapshot_of(word)) {
+      settle(snapshot, count_of(word));
+    }
+  }
+
+  static void settle(Snapshot* snapshot, int64_t delta) {
+    if (snapshot->refs.fetch_add(delta, std::memory_order_acq_rel) + delta ==
+        0) {
+      delete snapshot;
+    }
+  }
+
+  mutable std::atomic<uintptr_t> word_;
+};
@@ -0,0 +1,286 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "smart_pointers.hpp"
+
+namespace ref_count {
+// Biased reference counting: the thread that creates a block owns its shared
+// count and adjusts it with plain loads and stores, every other thread uses
+// an atomic count next to it. When the owner drops its last reference the
+// two are merged, and from then on everybody uses the atomic one.
+//
+// A reference taken by the owner may be dropped by another thread, driving
+// the atomic count below zero while the owner's stays positive. The first
+// thread to do so queues the block to its owner, which merges it the next
+// time it drops a reference, calls merge_pending(), or exits. Blocks whose
+// owner has already exited are merged by the thread that finds them.
+//
+//   SharedPtr<Node, ref_count::Biased> node =
+//       MakeShared<Node, ref_count::Biased>();
+struct Biased {
+  class Count;
+  using WeakCount = ThreadSafe::Count;
+  using Block = control_block::Counter<Biased>;
+
+  static void attach(Count& count, Block* block);
+  static void increment(Count& count);
+  static bool increment_if_nonzero(Count& count);
+  static bool decrement(Count& count);
+  static size_t load(const Count& count);
+
+  static void increment(WeakCount& count) { ThreadSafe::increment(count); }
+  static bool increment_if_nonzero(WeakCount& count) {
+    return ThreadSafe::increment_if_nonzero(count);
+  }
+  static bool decrement(WeakCount& count) {
+    return ThreadSafe::decrement(count);
+  }
+  static size_t load(const WeakCount& count) {
+    return ThreadSafe::load(count);
+  }
+
+  // Merges the blocks other threads have queued to the calling thread.
+  static void merge_pending();
+
+ private:
+  class Owner;
+
+  static uint64_t current_owner();
+  static bool is_owner(const Count& count);
+  static bool merge(Count& count);
+  static bool merge_owned(Count& count);
+  static bool hand_to_owner(Count& count);
+
+  static std::mutex& registry_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+  static std::unordered_map<uint64_t, Owner*>& registry() {
+    static std::unordered_map<uint64_t, Owner*> owners;
+    return owners;
+  }
+
+  // Identity of the calling thread while it can still merge; 0 before it
+  // creates its first block and once it has started to exit.
+  static inline thread_local uint64_t current_id_ = 0;
+  static inline thread_local Owner* current_ = nullptr;
+  static inline thread_local bool exited_ = false;
+};
+
+class Biased::Count {
+ public:
+  Count(uint32_t initial);
+
+ private:
+  friend struct Biased;
+
+  // shared_ holds a signed count scaled by kOne and two flags.
+  static constexpr int32_t kMerged = 1;
+  static constexpr int32_t kQueued = 2;
+  static constexpr int32_t kFlags = kMerged | kQueued;
+  static constexpr int32_t kOne = 4;
+
+  static int32_t count_of(int32_t value) { return (value & ~kFlags) / kOne; }
+
+  uint64_t owner_;
+  // Written only by the owner; atomic so that use_count() may peek.
+  std::atomic<uint32_t> biased_;
+  std::atomic<int32_t> shared_{0};
+  Block* block_ = nullptr;
+};
+
+// Registers a thread as an owner for as long as it runs.
+class Biased::Owner {
+ public:
+  Owner() {
+    static std::atomic<uint64_t> next_id{1};
+    id = next_id.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    registry()[id] = this;
+  }
+  Owner(const Owner&) = delete;
+  Owner& operator=(const Owner&) = delete;
+  // From here on the thread's references go through the atomic count, so
+  // its blocks can be merged by anybody.
+  ~Owner() {
+    current_id_ = 0;
+    current_ = nullptr;
+    exited_ = true;
+    std::vector<Count*> left;
+    {
+      std::lock_guard<std::mutex> lock(registry_mutex());
+      registry().erase(id);
+      left.swap(queue);
+    }
+    for (Count* count : left) {
+      if (merge(*count)) {
+        count->block_->expire();
+      }
+    }
+  }
+
+  uint64_t id;
+  std::atomic<bool> pending{false};
+  // Guarded by registry_mutex().
+  std::vector<Count*> queue;
+};
+
+inline Biased::Count::Count(uint32_t initial)
+    : owner_(Biased::current_owner()), biased_(initial) {
+  if (owner_ == 0) {
+    biased_.store(0, std::memory_order_relaxed);
+    shared_.store(static_cast<int32_t>(initial) * kOne | kMerged,
+                  std::memory_order_relaxed);
+  }
+}
+
+inline uint64_t Biased::current_owner() {
+  if (current_ == nullptr && !exited_) {
+    thread_local Owner owner;
+    current_ = &owner;
+    current_id_ = owner.id;
+  }
+  return current_id_;
+}
+
+inline bool Biased::is_owner(const Count& count) {
+  return count.owner_ == current_id_ && current_id_ != 0 &&
+         count.biased_.load(std::memory_order_relaxed) != 0;
+}
+
+inline void Biased::attach(Count& count, Block* block) {
+  count.block_ = block;
+}
+
+inline void Biased::increment(Count& count) {
+  if (is_owner(count)) {
+    count.biased_.store(count.biased_.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    return;
+  }
+  count.shared_.fetch_add(Count::kOne, std::memory_order_relaxed);
+}
+
+inline bool Biased::increment_if_nonzero(Count& count) {
+  if (is_owner(count)) {
+    increment(count);
+    return true;
+  }
+  // Until the merge the owner still holds a reference, so the object is
+  // alive whatever the atomic count says.
+  int32_t value = count.shared_.load(std::memory_order_relaxed);
+  while ((value & Count::kMerged) == 0 || Count::count_of(value) > 0) {
+    if (count.shared_.compare_exchange_weak(value, value + Count::kOne,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool Biased::decrement(Count& count) {
+  if (is_owner(count)) {
+    uint32_t biased = count.biased_.load(std::memory_order_relaxed) - 1;
+    count.biased_.store(biased, std::memory_order_relaxed);
+    bool last = biased == 0 && merge_owned(count);
+    if (current_->pending.load(std::memory_order_relaxed)) {
+      merge_pending();
+    }
+    return last;
+  }
+  int32_t value =
+      count.shared_.fetch_sub(Count::kOne, std::memory_order_acq_rel) -
+      Count::kOne;
+  if ((value & Count::kMerged) != 0) {
+    return Count::count_of(value) == 0;
+  }
+  if (Count::count_of(value) >= 0 || (value & Count::kQueued) != 0) {
+    return false;
+  }
+  return hand_to_owner(count);
+}
+
+inline size_t Biased::load(const Count& count) {
+  int64_t total = count.biased_.load(std::memory_order_relaxed) +
+                  Count::count_of(count.shared_.load(std::memory_order_relaxed));
+  return total > 0 ? static_cast<size_t>(total) : 0;
+}
+
+inline void Biased::merge_pending() {
+  if (current_ == nullptr) {
+    return;
+  }
+  current_->pending.store(false, std::memory_order_relaxed);
+  while (true) {
+    Count* count = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(registry_mutex());
+      if (current_->queue.empty()) {
+        return;
+      }
+      count = current_->queue.back();
+      current_->queue.pop_back();
+    }
+    // Popped before merging, so a destructor run by expire() that drops the
+    // owner's last reference to another queued block still finds it queued.
+    if (merge(*count)) {
+      count->block_->expire();
+    }
+  }
+}
+
+// Folds the owner's count into the atomic one. Only one thread ever merges a
+// given block: the owner, or the thread that queued it once the owner is gone.
+inline bool Biased::merge(Count& count) {
+  int32_t add = static_cast<int32_t>(
+                    count.biased_.load(std::memory_order_relaxed)) *
+                    Count::kOne +
+                Count::kMerged;
+  count.biased_.store(0, std::memory_order_relaxed);
+  int32_t value =
+      count.shared_.fetch_add(add, std::memory_order_acq_rel) + add;
+  return Count::count_of(value) == 0;
+}
+
+inline bool Biased::merge_owned(Count& count) {
+  bool last = merge(count);
+  // Queuing sets kQueued and pushes under the registry lock, so once the
+  // merge has seen the flag the block is already in the queue.
+  if ((count.shared_.load(std::memory_order_relaxed) & Count::kQueued) != 0) {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    std::vector<Count*>& queue = current_->queue;
+    for (size_t i = 0; i < queue.size(); ++i) {
+      if (queue[i] == &count) {
+        queue[i] = queue.back();
+        queue.pop_back();
+        break;
+      }
+    }
+  }
+  return last;
+}
+
+inline bool Biased::hand_to_owner(Count& count) {
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    int32_t value =
+        count.shared_.fetch_or(Count::kQueued, std::memory_order_acq_rel);
+    if ((value & (Count::kQueued | Count::kMerged)) != 0) {
+      return false;
+    }
+    auto owner = registry().find(count.owner_);
+    if (owner != registry().end()) {
+      owner->second->queue.push_back(&count);
+      owner->second->pending.store(true, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  // The owner has exited, so nobody else touches the biased count.
+  return merge(count);
+}
+};  // namespace ref_count
@@ -0,0 +1,143 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace block_pool {
+// Requests are rounded up to a multiple of kGranularity; anything above
+// kMaxBlockSize or more aligned than kGranularity bypasses the pool.
+inline constexpr size_t kGranularity = 16;
+inline constexpr size_t kMaxBlockSize = 128;
+inline constexpr size_t kClassCount = kMaxBlockSize / kGranularity;
+// Blocks beyond this many per class go back to operator delete, so a thread
+// that only frees blocks allocated elsewhere does not hoard memory.
+inline constexpr size_t kMaxCached = 256;
+
+inline size_t class_of(size_t size) { return (size - 1) / kGranularity; }
+
+inline size_t class_size(size_t size_class) {
+  return (size_class + 1) * kGranularity;
+}
+
+// Per-thread free lists. Every block comes from its own operator new call,
+// so a block may be freed into any thread's cache.
+class ThreadCache {
+ public:
+  ThreadCache() = default;
+  ThreadCache(const ThreadCache&) = delete;
+  ThreadCache& operator=(const ThreadCache&) = delete;
+  ~ThreadCache() {
+    for (FreeBlock* head : heads_) {
+      while (head != nullptr) {
+        FreeBlock* next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+    destroyed_ = true;
+  }
+
+  // nullptr once the calling thread's cache has been torn down, e.g. for
+  // blocks released from destructors of other thread_local objects.
+  static ThreadCache* get() {
+    if (destroyed_) {
+      return nullptr;
+    }
+    thread_local ThreadCache cache;
+    return &cache;
+  }
+
+  void* acquire(size_t size_class) {
+    FreeBlock* block = heads_[size_class];
+    if (block == nullptr) {
+      return ::operator new(class_size(size_class));
+    }
+    heads_[size_class] = block->next;
+    --counts_[size_class];
+    return block;
+  }
+
+  void release(void* ptr, size_t size_class) {
+    if (counts_[size_class] == kMaxCached) {
+      ::operator delete(ptr);
+      return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = heads_[size_class];
+    heads_[size_class] = block;
+    ++counts_[size_class];
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  static inline thread_local bool destroyed_ = false;
+
+  FreeBlock* heads_[kClassCount] = {};
+  size_t counts_[kClassCount] = {};
+};
+
+inline void* allocate(size_t size) {
+  ThreadCache* cache = ThreadCache::get();
+  if (cache == nullptr) {
+    return ::operator new(class_size(class_of(size)));
+  }
+  return cache->acquire(class_of(size));
+}
+
+inline void deallocate(void* ptr, size_t size) {
+  ThreadCache* cache = ThreadCache::get();
+  if (cache == nullptr) {
+    ::operator delete(ptr);
+    return;
+  }
+  cache->release(ptr, class_of(size));
+}
+};  // namespace block_pool
+
+// Stateless allocator serving single small objects from block_pool. Used for
+// the control blocks of SharedPtr(Y*) and SharedPtr(Y*, Deleter); pass it to
+// AllocateShared to pool the combined object and block as well.
+template <typename T>
+class BlockPoolAllocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  BlockPoolAllocator() = default;
+  template <typename U>
+  BlockPoolAllocator(const BlockPoolAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    if (count == 1 && is_pooled()) {
+      return static_cast<T*>(block_pool::allocate(sizeof(T)));
+    }
+    return std::allocator<T>().allocate(count);
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    if (count == 1 && is_pooled()) {
+      block_pool::deallocate(ptr, sizeof(T));
+      return;
+    }
+    std::allocator<T>().deallocate(ptr, count);
+  }
+
+  template <typename U>
+  bool operator==(const BlockPoolAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const BlockPoolAllocator<U>&) const {
+    return false;
+  }
+
+ private:
+  static constexpr bool is_pooled() {
+    return sizeof(T) <= block_pool::kMaxBlockSize &&
+           alignof(T) <= block_pool::kGranularity;
+  }
+};
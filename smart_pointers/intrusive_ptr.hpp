@@ -0,0 +1,148 @@
+#pragma once
+#include <type_traits>
+#include <utility>
+
+#include "smart_pointers.hpp"
+
+template <typename T>
+class IntrusivePtr;
+
+// CRTP base that keeps the reference count inside the object, so an
+// IntrusivePtr costs one allocation and no control block. Derived is
+// destroyed with delete once the count drops to zero; classes deriving from
+// Derived need a virtual destructor.
+//
+//   struct Node : RefCounted<Node> { IntrusivePtr<Node> next; };
+//   IntrusivePtr<Node> head = MakeIntrusive<Node>();
+template <typename Derived, typename Policy = ref_count::ThreadSafe>
+class RefCounted {
+  static_assert(!ref_count::HasAttach<Policy>::value,
+                "the policy needs a control block");
+
+ public:
+  size_t use_count() const { return Policy::load(count_); }
+
+  // Any object that is already owned can hand out more owners.
+  IntrusivePtr<Derived> intrusive_from_this() {
+    return IntrusivePtr<Derived>(static_cast<Derived*>(this));
+  }
+  IntrusivePtr<const Derived> intrusive_from_this() const {
+    return IntrusivePtr<const Derived>(static_cast<const Derived*>(this));
+  }
+
+ protected:
+  RefCounted() = default;
+  // A copy is a different object with owners of its own.
+  RefCounted(const RefCounted&) {}
+  RefCounted& operator=(const RefCounted&) { return *this; }
+  ~RefCounted() = default;
+
+ private:
+  template <typename T>
+  friend class IntrusivePtr;
+
+  void add_ref() const { Policy::increment(count_); }
+  void release_ref() const {
+    if (Policy::decrement(count_)) {
+      delete static_cast<const Derived*>(this);
+    }
+  }
+
+  mutable typename Policy::Count count_{0};
+};
+
+template <typename T>
+class IntrusivePtr {
+ private:
+  T* ptr_ = nullptr;
+
+  template <typename Y>
+  friend class IntrusivePtr;
+
+  void acquire() {
+    if (ptr_ != nullptr) {
+      ptr_->add_ref();
+    }
+  }
+
+  void release() {
+    if (ptr_ != nullptr) {
+      ptr_->release_ref();
+    }
+  }
+
+ public:
+  IntrusivePtr() = default;
+  IntrusivePtr(std::nullptr_t) {}
+
+  // Adds an owner to ptr, which may be a fresh object or one that is
+  // already owned elsewhere (e.g. this).
+  explicit IntrusivePtr(T* ptr) : ptr_(ptr) { acquire(); }
+
+  IntrusivePtr(const IntrusivePtr& other) : ptr_(other.ptr_) { acquire(); }
+
+  template <typename Y>
+  IntrusivePtr(const IntrusivePtr<Y>& other) : ptr_(other.ptr_) {
+    acquire();
+  }
+
+  IntrusivePtr(IntrusivePtr&& other) noexcept : ptr_(other.ptr_) {
+    other.ptr_ = nullptr;
+  }
+
+  template <typename Y>
+  IntrusivePtr(IntrusivePtr<Y>&& other) noexcept : ptr_(other.ptr_) {
+    other.ptr_ = nullptr;
+  }
+
+  ~IntrusivePtr() { release(); }
+
+  IntrusivePtr& operator=(const IntrusivePtr& other) {
+    IntrusivePtr dop(other);
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  template <typename Y>
+  IntrusivePtr& operator=(const IntrusivePtr<Y>& other) {
+    IntrusivePtr dop(other);
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
+    IntrusivePtr dop(std::move(other));
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  template <typename Y>
+  IntrusivePtr& operator=(IntrusivePtr<Y>&& other) noexcept {
+    IntrusivePtr dop(std::move(other));
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  size_t use_count() const {
+    if (ptr_ == nullptr) {
+      return 0;
+    }
+    return ptr_->use_count();
+  }
+
+  T* get() const { return ptr_; }
+
+  T& operator*() const { return *ptr_; }
+
+  T* operator->() const { return ptr_; }
+
+  void reset() {
+    release();
+    ptr_ = nullptr;
+  }
+};
+
+template <typename T, typename... Args>
+IntrusivePtr<T> MakeIntrusive(Args&&... args) {
+  return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
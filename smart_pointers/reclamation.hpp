@@ -0,0 +1,482 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+// Deferred reclamation for lock-free readers: instead of taking a reference
+// on every object they visit, readers announce what they may be looking at
+// and writers retire() unlinked objects, which are freed once no reader can
+// still reach them. Reading touches only the reader's own cache line.
+//
+// EpochDomain makes a whole critical section safe for the price of two
+// stores, but one stalled reader holds back every retired object.
+// HazardDomain protects individual pointers, so memory held back stays
+// bounded, at the price of a fenced store per pointer.
+//
+//   std::atomic<Node*> head;
+//   {
+//     EpochDomain::Guard guard(domain);
+//     for (Node* node = head.load(); node; node = node->next.load()) ...
+//   }
+//   domain.retire(unlinked);  // or retire(unlinked, deleter)
+namespace reclamation {
+// An object waiting to be freed. The deleter follows the same concept as the
+// one of control_block::Base: any copyable callable taking a T*. Empty
+// deleters are recreated at reclamation, others are kept on the heap.
+class Retired {
+ public:
+  template <typename T, typename Deleter>
+  Retired(T* ptr, const Deleter& deleter)
+      : ptr_(const_cast<void*>(static_cast<const void*>(ptr))) {
+    if constexpr (std::is_empty_v<Deleter> &&
+                  std::is_default_constructible_v<Deleter>) {
+      reclaim_ = [](void* ptr, void*) { Deleter()(static_cast<T*>(ptr)); };
+    } else {
+      state_ = new Deleter(deleter);
+      reclaim_ = [](void* ptr, void* state) {
+        std::unique_ptr<Deleter> cleanup(static_cast<Deleter*>(state));
+        (*cleanup)(static_cast<T*>(ptr));
+      };
+    }
+  }
+
+  const void* get() const { return ptr_; }
+  void reclaim() { reclaim_(ptr_, state_); }
+
+ private:
+  void* ptr_;
+  void (*reclaim_)(void*, void*);
+  void* state_ = nullptr;
+};
+
+// Remembers which record the calling thread holds in each domain and gives
+// the records back when the thread exits. Domains are told apart by an id
+// that is never reused, so a record of a destroyed domain is never touched.
+class ThreadRecords {
+ public:
+  using Release = void (*)(void*);
+
+  static uint64_t register_domain() {
+    static std::atomic<uint64_t> next_id{1};
+    uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex());
+    live().insert(id);
+    return id;
+  }
+
+  static void unregister_domain(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex());
+    live().erase(id);
+  }
+
+  static void* find(uint64_t id) {
+    Cache& cache = local();
+    if (cache.last_id == id) {
+      return cache.last_record;
+    }
+    for (const Entry& entry : cache.entries) {
+      if (entry.id == id) {
+        cache.last_id = id;
+        cache.last_record = entry.record;
+        return entry.record;
+      }
+    }
+    return nullptr;
+  }
+
+  static void add(uint64_t id, void* record, Release release) {
+    Cache& cache = local();
+    cache.entries.push_back({id, record, release});
+    cache.last_id = id;
+    cache.last_record = record;
+  }
+
+ private:
+  struct Entry {
+    uint64_t id;
+    void* record;
+    Release release;
+  };
+
+  struct Cache {
+    Cache() = default;
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+    // Holding the lock keeps the domains alive while their records are
+    // handed back.
+    ~Cache() {
+      std::lock_guard<std::mutex> lock(mutex());
+      for (const Entry& entry : entries) {
+        if (live().count(entry.id) != 0) {
+          entry.release(entry.record);
+        }
+      }
+    }
+
+    uint64_t last_id = 0;
+    void* last_record = nullptr;
+    std::vector<Entry> entries;
+  };
+
+  static Cache& local() {
+    thread_local Cache cache;
+    return cache;
+  }
+
+  static std::mutex& mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+  static std::unordered_set<uint64_t>& live() {
+    static std::unordered_set<uint64_t> ids;
+    return ids;
+  }
+};
+
+// The per-thread records of a domain, in a list that only grows until the
+// domain is destroyed, so readers of the list need no locking. A record
+// given back by an exiting thread is reused by the next thread that asks,
+// together with whatever it still has to retire.
+template <typename Record>
+class RecordList {
+ public:
+  RecordList() : id_(ThreadRecords::register_domain()) {}
+  RecordList(const RecordList&) = delete;
+  RecordList& operator=(const RecordList&) = delete;
+  ~RecordList() {
+    ThreadRecords::unregister_domain(id_);
+    Record* record = head_.load(std::memory_order_acquire);
+    while (record != nullptr) {
+      Record* next = record->next;
+      delete record;
+      record = next;
+    }
+  }
+
+  Record& local() {
+    if (void* record = ThreadRecords::find(id_)) {
+      return *static_cast<Record*>(record);
+    }
+    Record* record = acquire();
+    ThreadRecords::add(id_, record, &RecordList::release);
+    return *record;
+  }
+
+  template <typename Func>
+  void for_each(Func func) {
+    for (Record* record = head_.load(std::memory_order_acquire);
+         record != nullptr; record = record->next) {
+      func(*record);
+    }
+  }
+
+ private:
+  Record* acquire() {
+    for (Record* record = head_.load(std::memory_order_acquire);
+         record != nullptr; record = record->next) {
+      bool expected = false;
+      if (!record->in_use.load(std::memory_order_relaxed) &&
+          record->in_use.compare_exchange_strong(expected, true,
+                                                 std::memory_order_acquire)) {
+        return record;
+      }
+    }
+    Record* record = new Record();
+    record->in_use.store(true, std::memory_order_relaxed);
+    record->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(record->next, record,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    return record;
+  }
+
+  static void release(void* ptr) {
+    Record* record = static_cast<Record*>(ptr);
+    record->on_thread_exit();
+    record->in_use.store(false, std::memory_order_release);
+  }
+
+  uint64_t id_;
+  std::atomic<Record*> head_{nullptr};
+};
+
+// Retired lists are scanned once they reach this many objects, and then
+// again only once they have doubled since, so that objects held back by a
+// stalled reader cost amortised constant time per retire().
+inline constexpr size_t kCollectThreshold = 64;
+
+inline size_t next_collect(size_t kept) {
+  return std::max(kCollectThreshold, 2 * kept);
+}
+};  // namespace reclamation
+
+// Epoch-based reclamation. A reader pins the global epoch for the duration
+// of a Guard; the epoch advances once every pinned thread has seen it, and
+// an object retired during epoch e is freed once the epoch reaches e + 2,
+// when every reader that could have seen it has unpinned.
+class EpochDomain {
+ private:
+  struct Entry {
+    reclamation::Retired retired;
+    uint64_t epoch;
+  };
+
+  struct Record {
+    // Epoch the thread is pinned at, shifted left by one, with the low bit
+    // set; 0 while the thread is outside any guard.
+    std::atomic<uint64_t> state{0};
+    std::atomic<bool> in_use{false};
+    Record* next = nullptr;
+    // Owner-only from here on.
+    size_t depth = 0;
+    std::vector<Entry> retired;
+    size_t collect_at = reclamation::kCollectThreshold;
+
+    void on_thread_exit() {}
+  };
+
+ public:
+  // Pins the calling thread; guards may nest.
+  class Guard {
+   public:
+    explicit Guard(EpochDomain& domain)
+        : domain_(domain), record_(domain.records_.local()) {
+      domain_.enter(record_);
+    }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+    ~Guard() { domain_.leave(record_); }
+
+   private:
+    EpochDomain& domain_;
+    Record& record_;
+  };
+
+  EpochDomain() = default;
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+  // No thread may be inside a guard any more.
+  ~EpochDomain() {
+    records_.for_each([](Record& record) {
+      for (Entry& entry : record.retired) {
+        entry.retired.reclaim();
+      }
+    });
+  }
+
+  static EpochDomain& global() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  // ptr must already be unreachable for readers that start from now on.
+  template <typename T, typename Deleter = std::default_delete<T>>
+  void retire(T* ptr, const Deleter& deleter = Deleter()) {
+    Record& record = records_.local();
+    record.retired.push_back({reclamation::Retired(ptr, deleter),
+                              epoch_.load(std::memory_order_seq_cst)});
+    if (record.retired.size() >= record.collect_at) {
+      collect(record);
+    }
+  }
+
+  // Frees what the calling thread retired and no reader can reach any more.
+  void collect() { collect(records_.local()); }
+
+ private:
+  // The announcement is only trusted once the epoch is seen unchanged after
+  // it, so no advance can have missed it.
+  void enter(Record& record) {
+    if (record.depth++ != 0) {
+      return;
+    }
+    uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    while (true) {
+      record.state.store(epoch << 1 | 1, std::memory_order_seq_cst);
+      uint64_t current = epoch_.load(std::memory_order_seq_cst);
+      if (current == epoch) {
+        return;
+      }
+      epoch = current;
+    }
+  }
+
+  void leave(Record& record) {
+    if (--record.depth == 0) {
+      record.state.store(0, std::memory_order_release);
+    }
+  }
+
+  void try_advance() {
+    uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+    bool behind = false;
+    records_.for_each([&](Record& record) {
+      uint64_t state = record.state.load(std::memory_order_seq_cst);
+      if ((state & 1) != 0 && (state >> 1) != epoch) {
+        behind = true;
+      }
+    });
+    if (!behind) {
+      epoch_.compare_exchange_strong(epoch, epoch + 1,
+                                     std::memory_order_seq_cst);
+    }
+  }
+
+  void collect(Record& record) {
+    try_advance();
+    uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+    // Deleters may retire more objects into the list.
+    std::vector<Entry> pending;
+    pending.swap(record.retired);
+    std::vector<Entry> kept;
+    for (Entry& entry : pending) {
+      if (entry.epoch + 2 <= epoch) {
+        entry.retired.reclaim();
+      } else {
+        kept.push_back(entry);
+      }
+    }
+    record.retired.insert(record.retired.end(), kept.begin(), kept.end());
+    record.collect_at = reclamation::next_collect(kept.size());
+  }
+
+  std::atomic<uint64_t> epoch_{0};
+  reclamation::RecordList<Record> records_;
+};
+
+// Hazard pointers. A reader publishes each pointer it is about to follow in
+// one of its thread's kSlots slots; a retired object is freed by the first
+// scan that finds it in no slot.
+class HazardDomain {
+ public:
+  static constexpr size_t kSlots = 4;
+
+ private:
+  struct Record {
+    std::atomic<const void*> slots[kSlots] = {};
+    std::atomic<bool> in_use{false};
+    Record* next = nullptr;
+    // Owner-only from here on.
+    bool taken[kSlots] = {};
+    std::vector<reclamation::Retired> retired;
+    size_t collect_at = reclamation::kCollectThreshold;
+
+    void on_thread_exit() {
+      for (auto& slot : slots) {
+        slot.store(nullptr, std::memory_order_release);
+      }
+    }
+  };
+
+ public:
+  // Owns one of the calling thread's slots.
+  class Holder {
+   public:
+    explicit Holder(HazardDomain& domain) : record_(domain.records_.local()) {
+      for (index_ = 0; index_ < kSlots; ++index_) {
+        if (!record_.taken[index_]) {
+          record_.taken[index_] = true;
+          return;
+        }
+      }
+      throw std::length_error("out of hazard pointer slots");
+    }
+    Holder(const Holder&) = delete;
+    Holder& operator=(const Holder&) = delete;
+    ~Holder() {
+      reset();
+      record_.taken[index_] = false;
+    }
+
+    // Loads source and keeps the object it points to alive until the next
+    // protect() or reset(). The value is only trusted once source is seen
+    // unchanged after publishing it, so no scan can have missed it.
+    template <typename T>
+    T* protect(const std::atomic<T*>& source) {
+      T* ptr = source.load(std::memory_order_relaxed);
+      while (true) {
+        record_.slots[index_].store(ptr, std::memory_order_seq_cst);
+        T* current = source.load(std::memory_order_seq_cst);
+        if (current == ptr) {
+          return ptr;
+        }
+        ptr = current;
+      }
+    }
+
+    void reset() {
+      record_.slots[index_].store(nullptr, std::memory_order_release);
+    }
+
+   private:
+    Record& record_;
+    size_t index_;
+  };
+
+  HazardDomain() = default;
+  HazardDomain(const HazardDomain&) = delete;
+  HazardDomain& operator=(const HazardDomain&) = delete;
+  // No thread may be holding a protected pointer any more.
+  ~HazardDomain() {
+    records_.for_each([](Record& record) {
+      for (reclamation::Retired& retired : record.retired) {
+        retired.reclaim();
+      }
+    });
+  }
+
+  static HazardDomain& global() {
+    static HazardDomain domain;
+    return domain;
+  }
+
+  // ptr must already be unreachable for readers that start from now on.
+  template <typename T, typename Deleter = std::default_delete<T>>
+  void retire(T* ptr, const Deleter& deleter = Deleter()) {
+    Record& record = records_.local();
+    record.retired.emplace_back(ptr, deleter);
+    if (record.retired.size() >= record.collect_at) {
+      collect(record);
+    }
+  }
+
+  // Frees what the calling thread retired and no slot protects.
+  void collect() { collect(records_.local()); }
+
+ private:
+  void collect(Record& record) {
+    std::vector<const void*> hazards;
+    records_.for_each([&](Record& other) {
+      for (const auto& slot : other.slots) {
+        if (const void* ptr = slot.load(std::memory_order_seq_cst)) {
+          hazards.push_back(ptr);
+        }
+      }
+    });
+    std::sort(hazards.begin(), hazards.end(), std::less<const void*>());
+    // Deleters may retire more objects into the list.
+    std::vector<reclamation::Retired> pending;
+    pending.swap(record.retired);
+    std::vector<reclamation::Retired> kept;
+    for (reclamation::Retired& retired : pending) {
+      if (std::binary_search(hazards.begin(), hazards.end(), retired.get(),
+                             std::less<const void*>())) {
+        kept.push_back(retired);
+      } else {
+        retired.reclaim();
+      }
+    }
+    record.retired.insert(record.retired.end(), kept.begin(), kept.end());
+    record.collect_at = reclamation::next_collect(kept.size());
+  }
+
+  reclamation::RecordList<Record> records_;
+};
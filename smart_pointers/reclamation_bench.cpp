@@ -0,0 +1,164 @@
+// Reader scaling of the reclamation domains against SharedPtr: 1 to 64
+// threads keep reading one shared object while a writer replaces it every
+// 100 microseconds. A SharedPtr reader loads through AtomicSharedPtr and so
+// bumps the shared counts; an epoch reader pins the epoch around the read,
+// a hazard pointer reader publishes the pointer in its own slot.
+//
+//   g++ -std=c++17 -O2 -pthread reclamation_bench.cpp -o bench
+//   ./bench [milliseconds per run]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "atomic_shared_ptr.hpp"
+#include "reclamation.hpp"
+
+namespace {
+struct Config {
+  explicit Config(long version) : first(version), second(version) {}
+
+  long first;
+  long second;
+};
+
+class SharedReaders {
+ public:
+  SharedReaders() : current_(MakeShared<Config>(0)) {}
+
+  void replace(long version) { current_.store(MakeShared<Config>(version)); }
+
+  struct Reader {
+    explicit Reader(SharedReaders& subject) : subject(subject) {}
+
+    long read() {
+      SharedPtr<Config> config = subject.current_.load();
+      return config->first - config->second;
+    }
+
+    SharedReaders& subject;
+  };
+
+ private:
+  AtomicSharedPtr<Config> current_;
+};
+
+class EpochReaders {
+ public:
+  ~EpochReaders() { delete current_.load(); }
+
+  void replace(long version) {
+    domain_.retire(current_.exchange(new Config(version)));
+  }
+
+  struct Reader {
+    explicit Reader(EpochReaders& subject) : subject(subject) {}
+
+    long read() {
+      EpochDomain::Guard guard(subject.domain_);
+      Config* config = subject.current_.load(std::memory_order_acquire);
+      return config->first - config->second;
+    }
+
+    EpochReaders& subject;
+  };
+
+ private:
+  EpochDomain domain_;
+  std::atomic<Config*> current_{new Config(0)};
+};
+
+class HazardReaders {
+ public:
+  ~HazardReaders() { delete current_.load(); }
+
+  void replace(long version) {
+    domain_.retire(current_.exchange(new Config(version)));
+  }
+
+  struct Reader {
+    explicit Reader(HazardReaders& subject)
+        : subject(subject), holder(subject.domain_) {}
+
+    long read() {
+      Config* config = holder.protect(subject.current_);
+      long result = config->first - config->second;
+      holder.reset();
+      return result;
+    }
+
+    HazardReaders& subject;
+    HazardDomain::Holder holder;
+  };
+
+ private:
+  HazardDomain domain_;
+  std::atomic<Config*> current_{new Config(0)};
+};
+
+// Million reads per second over all readers.
+template <typename Subject>
+double run(size_t readers, std::chrono::milliseconds duration) {
+  Subject subject;
+  std::atomic<bool> start{false};
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> total{0};
+  std::atomic<long> torn{0};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < readers; ++i) {
+    threads.emplace_back([&] {
+      typename Subject::Reader reader(subject);
+      size_t reads = 0;
+      long mismatches = 0;
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      while (!stop.load(std::memory_order_relaxed)) {
+        mismatches += reader.read() != 0;
+        ++reads;
+      }
+      total.fetch_add(reads, std::memory_order_relaxed);
+      torn.fetch_add(mismatches, std::memory_order_relaxed);
+    });
+  }
+  threads.emplace_back([&] {
+    long version = 0;
+    while (!start.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+    while (!stop.load(std::memory_order_relaxed)) {
+      subject.replace(++version);
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - begin;
+  if (torn.load() != 0) {
+    std::fprintf(stderr, "%ld reads saw a torn object\n", torn.load());
+  }
+  return static_cast<double>(total.load()) / elapsed.count() / 1e6;
+}
+};  // namespace
+
+int main(int argc, char** argv) {
+  std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+  std::printf("%8s %14s %14s %14s\n", "readers", "SharedPtr", "epoch",
+              "hazard");
+  for (size_t readers = 1; readers <= 64; readers *= 2) {
+    double shared = run<SharedReaders>(readers, duration);
+    double epoch = run<EpochReaders>(readers, duration);
+    double hazard = run<HazardReaders>(readers, duration);
+    std::printf("%8zu %14.2f %14.2f %14.2f\n", readers, shared, epoch,
+                hazard);
+  }
+  std::printf("(million reads per second)\n");
+}
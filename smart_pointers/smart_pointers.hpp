@@ -1,172 +1,432 @@
 #pragma once
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <type_traits>
+
+#include "block_pool.hpp"
+
+namespace ref_count {
+// Counting policies for SharedPtr and WeakPtr: the count type and the
+// operations on it. decrement() returns true when the count drops to zero.
+struct ThreadSafe {
+  using Count = std::atomic<uint32_t>;
+  using WeakCount = Count;
+
+  static void increment(Count& count) {
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+  // Never revives a count that has already reached zero.
+  static bool increment_if_nonzero(Count& count) {
+    uint32_t current = count.load(std::memory_order_relaxed);
+    while (current != 0) {
+      if (count.compare_exchange_weak(current, current + 1,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  // Every owner releases its writes to the object; the last one acquires
+  // them all before the object is destroyed.
+  static bool decrement(Count& count) {
+    return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+  static size_t load(const Count& count) {
+    return count.load(std::memory_order_relaxed);
+  }
+};
+
+// Plain counters for pointers that never leave their thread.
+struct SingleThreaded {
+  using Count = uint32_t;
+  using WeakCount = Count;
+
+  static void increment(Count& count) { ++count; }
+  static bool increment_if_nonzero(Count& count) {
+    if (count == 0) {
+      return false;
+    }
+    ++count;
+    return true;
+  }
+  static bool decrement(Count& count) { return --count == 0; }
+  static size_t load(const Count& count) { return count; }
+};
+
+// Policies whose shared count needs to know its control block provide
+// attach(Count&, control_block::Counter<Policy>*).
+template <typename Policy, typename = void>
+struct HasAttach : std::false_type {};
+template <typename Policy>
+struct HasAttach<Policy, std::void_t<decltype(&Policy::attach)>>
+    : std::true_type {};
+};  // namespace ref_count
 
 namespace control_block {
+enum class Operation { kDestroyObject, kDeallocateBlock };
+
+// Common head of every control block: 32-bit counts and one type-erased
+// manager function instead of a vtable. count_weak holds one extra reference
+// on behalf of all shared owners, so whoever drops the last reference of
+// either kind frees the block.
+template <typename Policy>
 struct Counter {
- public:
-  size_t count_shared = 0;
-  size_t count_weak = 0;
-  void* object_ptr;
-  virtual void deallocate_block() {}
-  virtual void delete_ptr() {}
-  virtual ~Counter() = default;
+  using Manager = void (*)(Counter*, Operation);
+
+  explicit Counter(Manager manager) : manager(manager) {
+    if constexpr (ref_count::HasAttach<Policy>::value) {
+      Policy::attach(count_shared, this);
+    }
+  }
+
+  Manager manager;
+  typename Policy::Count count_shared{1};
+  typename Policy::WeakCount count_weak{1};
+
+  void add_shared() { Policy::increment(count_shared); }
+  void add_weak() { Policy::increment(count_weak); }
+  // Promotes a weak reference; fails once the object is gone.
+  bool try_add_shared() { return Policy::increment_if_nonzero(count_shared); }
+  void release_shared() {
+    if (Policy::decrement(count_shared)) {
+      expire();
+    }
+  }
+  // Destroys the object once the shared count is known to be zero.
+  void expire() {
+    manager(this, Operation::kDestroyObject);
+    release_weak();
+  }
+  void release_weak() {
+    if (Policy::decrement(count_weak)) {
+      manager(this, Operation::kDeallocateBlock);
+    }
+  }
+  size_t use_count() const { return Policy::load(count_shared); }
 };
 
-template <typename T, typename Deleter = std::default_delete<T>,
-          typename Alloc = std::allocator<T>>
-struct Base : public Counter {
-  Deleter deleter;
-  Alloc alloc;
+// Stores an empty, non-final T as a base so that it takes no space.
+template <typename T, int kIndex,
+          bool kCompress = std::is_empty_v<T> && !std::is_final_v<T>>
+struct Compressed {
+  explicit Compressed(const T& value) : value(value) {}
+  T& get() { return value; }
 
-  using alloc_traits = std::allocator_traits<Alloc>;
-  using block_alloc = typename alloc_traits::template rebind_alloc<
-      control_block::Base<T, Deleter, Alloc>>;
-  using block_alloc_traits = typename alloc_traits::template rebind_traits<
-      control_block::Base<T, Deleter, Alloc>>;
+  T value;
+};
 
-  template <typename Y>
-  Base(Y* ptr, Deleter deleter = Deleter(), Alloc alloc = Alloc())
-      : deleter(deleter), alloc(alloc) {
-    Counter::object_ptr = ptr;
-  }
+template <typename T, int kIndex>
+struct Compressed<T, kIndex, true> : private T {
+  explicit Compressed(const T& value) : T(value) {}
+  T& get() { return *this; }
+};
 
-  Base(std::nullptr_t, Deleter deleter = Deleter(), Alloc alloc = Alloc())
-      : deleter(deleter), alloc(alloc) {
-    Counter::object_ptr = nullptr;
+// Block for an object owned through a raw pointer.
+template <typename Y, typename Deleter, typename Alloc, typename Policy>
+struct Base : public Counter<Policy>,
+              private Compressed<Deleter, 0>,
+              private Compressed<Alloc, 1> {
+  using alloc_traits = std::allocator_traits<Alloc>;
+  using block_alloc = typename alloc_traits::template rebind_alloc<Base>;
+  using block_alloc_traits =
+      typename alloc_traits::template rebind_traits<Base>;
+
+  Y* ptr;
+
+  Base(Y* ptr, const Deleter& deleter, const Alloc& alloc)
+      : Counter<Policy>(&manage),
+        Compressed<Deleter, 0>(deleter),
+        Compressed<Alloc, 1>(alloc),
+        ptr(ptr) {}
+
+  static void manage(Counter<Policy>* counter, Operation operation) {
+    Base* block = static_cast<Base*>(counter);
+    if (operation == Operation::kDestroyObject) {
+      block->Compressed<Deleter, 0>::get()(block->ptr);
+      return;
+    }
+    block_alloc alloc = block->Compressed<Alloc, 1>::get();
+    block_alloc_traits::destroy(alloc, block);
+    block_alloc_traits::deallocate(alloc, block, 1);
   }
+};
+
+// Block that holds the object itself, built with a single allocation.
+template <typename T, typename Alloc, typename Policy>
+struct Make : public Counter<Policy>, private Compressed<Alloc, 0> {
+  using alloc_traits = std::allocator_traits<Alloc>;
+  using object_alloc = typename alloc_traits::template rebind_alloc<T>;
+  using object_alloc_traits =
+      typename alloc_traits::template rebind_traits<T>;
+  using block_alloc = typename alloc_traits::template rebind_alloc<Make>;
+  using block_alloc_traits =
+      typename alloc_traits::template rebind_traits<Make>;
+
+  // Lives in a union so that its lifetime ends with the last shared owner
+  // rather than with the block.
+  union {
+    T object;
+  };
 
-  void deallocate_block() {
-    block_alloc block_alloc = alloc;
-    block_alloc_traits::deallocate(block_alloc, this, 1);
+  template <typename... Args>
+  explicit Make(const Alloc& alloc, Args&&... args)
+      : Counter<Policy>(&manage), Compressed<Alloc, 0>(alloc) {
+    object_alloc object_al = alloc;
+    object_alloc_traits::construct(object_al, &object,
+                                   std::forward<Args>(args)...);
   }
+  ~Make() {}
+
+  T* get() { return &object; }
 
-  void delete_ptr() { deleter(static_cast<T*>(Counter::object_ptr)); }
-  ~Base() = default;
+  static void manage(Counter<Policy>* counter, Operation operation) {
+    Make* block = static_cast<Make*>(counter);
+    if (operation == Operation::kDestroyObject) {
+      object_alloc object_al = block->Compressed<Alloc, 0>::get();
+      object_alloc_traits::destroy(object_al, &block->object);
+      return;
+    }
+    block_alloc block_al = block->Compressed<Alloc, 0>::get();
+    block_alloc_traits::destroy(block_al, block);
+    block_alloc_traits::deallocate(block_al, block, 1);
+  }
 };
-template <typename T, typename Alloc = std::allocator<T>>
-struct Make : Counter {
-  T object;
-  Alloc alloc;
+
+// Block followed, in the same allocation, by count elements of type T.
+template <typename T, typename Alloc, typename Policy>
+struct MakeArray : public Counter<Policy>, private Compressed<Alloc, 0> {
+  static_assert(!std::is_array_v<T>, "arrays of arrays are not supported");
+
+  static constexpr size_t kAlign = std::max(
+      {alignof(Counter<Policy>), alignof(Alloc), alignof(size_t), alignof(T)});
+  // Allocation unit, aligned for both the block and the elements.
+  struct Unit {
+    alignas(kAlign) unsigned char bytes[kAlign];
+  };
+
   using alloc_traits = std::allocator_traits<Alloc>;
-  using block_alloc = typename alloc_traits::template rebind_alloc<
-      control_block::Make<T, Alloc>>;
-  using block_alloc_traits = typename alloc_traits::template rebind_traits<
-      control_block::Make<T, Alloc>>;
+  using object_alloc = typename alloc_traits::template rebind_alloc<T>;
+  using object_alloc_traits =
+      typename alloc_traits::template rebind_traits<T>;
+  using unit_alloc = typename alloc_traits::template rebind_alloc<Unit>;
+  using unit_alloc_traits =
+      typename alloc_traits::template rebind_traits<Unit>;
+
+  size_t count;
+
+  MakeArray(const Alloc& alloc, size_t count)
+      : Counter<Policy>(&manage), Compressed<Alloc, 0>(alloc), count(count) {}
+
+  // Returns a block whose elements are not constructed yet.
+  static MakeArray* allocate(const Alloc& alloc, size_t count) {
+    unit_alloc units = alloc;
+    Unit* memory = unit_alloc_traits::allocate(units, unit_count(count));
+    return ::new (static_cast<void*>(memory)) MakeArray(alloc, count);
+  }
 
-  template <typename... Args>
-  Make(Args&&... args) : object(std::forward<Args>(args)...) {
-    alloc = Alloc();
-    Counter::object_ptr = &object;
-    ++Counter::count_shared;
+  T* data() {
+    return reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(this) +
+                                elements_offset());
   }
 
-  void deallocate_block() {
-    block_alloc block_al = alloc;
-    block_alloc_traits::deallocate(block_al, this, 1);
+  Alloc& allocator() { return Compressed<Alloc, 0>::get(); }
+
+  // Destroys the first constructed elements, last to first.
+  void destroy_elements(size_t constructed) {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      object_alloc object_al = allocator();
+      while (constructed != 0) {
+        object_alloc_traits::destroy(object_al, data() + --constructed);
+      }
+    }
   }
 
-  void delete_ptr() {
-    alloc_traits::destroy(alloc, static_cast<T*>(Counter::object_ptr));
+  void deallocate() {
+    unit_alloc units = allocator();
+    size_t size = unit_count(count);
+    this->~MakeArray();
+    unit_alloc_traits::deallocate(units, reinterpret_cast<Unit*>(this), size);
+  }
+
+  static void manage(Counter<Policy>* counter, Operation operation) {
+    MakeArray* block = static_cast<MakeArray*>(counter);
+    if (operation == Operation::kDestroyObject) {
+      block->destroy_elements(block->count);
+      return;
+    }
+    block->deallocate();
+  }
+
+ private:
+  static constexpr size_t elements_offset() {
+    return (sizeof(MakeArray) + alignof(T) - 1) / alignof(T) * alignof(T);
+  }
+
+  static size_t unit_count(size_t count) {
+    return (elements_offset() + count * sizeof(T) + sizeof(Unit) - 1) /
+           sizeof(Unit);
   }
 };
+
+struct Factory;
 };  // namespace control_block
 
-template <typename T>
+template <typename T, typename Policy = ref_count::ThreadSafe>
+class SharedPtr;
+
+template <typename T, typename Policy = ref_count::ThreadSafe>
+class WeakPtr;
+
+template <typename T, typename Policy = ref_count::ThreadSafe>
+class EnableSharedFromThis;
+
+// T may be an array of unknown bound, U[]; the pointer is then a U* and
+// the default deleter uses delete[].
+template <typename T, typename Policy>
 class SharedPtr {
+ public:
+  using element_type = std::remove_extent_t<T>;
+
  private:
-  T* ptr_;
-  control_block::Counter* control_block_ = nullptr;
+  using counter = control_block::Counter<Policy>;
 
-  template <typename U, typename... Args>
-  friend SharedPtr<U> MakeShared(Args&&... args);
+  element_type* ptr_;
+  counter* control_block_ = nullptr;
 
-  template <typename U, typename Alloc>
-  SharedPtr(control_block::Make<U, Alloc>* control_block) {
-    control_block_ = control_block;
-    ptr_ = static_cast<T*>(control_block_->object_ptr);
-  }
-
-  template <typename U>
+  template <typename U, typename OtherPolicy>
   friend class WeakPtr;
 
-  template <typename U, typename Alloc, typename... Args>
-  friend SharedPtr<U> AllocateShared(const Alloc& alloc, Args&&... args);
+  friend struct control_block::Factory;
 
-  template <typename Y>
+  template <typename Y, typename OtherPolicy>
   friend class SharedPtr;
 
+  template <typename U>
+  friend class AtomicSharedPtr;
+
+  struct AdoptTag {};
+
+  // Adopts a shared reference already taken on control_block.
+  SharedPtr(AdoptTag, element_type* ptr, counter* control_block)
+      : ptr_(ptr), control_block_(control_block) {}
+
+  template <typename Y, typename Deleter, typename Alloc>
+  void create_block(Y* ptr, const Deleter& deleter, const Alloc& alloc) {
+    using block = control_block::Base<Y, Deleter, Alloc, Policy>;
+    using alloc_traits = std::allocator_traits<Alloc>;
+    using block_alloc = typename alloc_traits::template rebind_alloc<block>;
+    using block_alloc_traits =
+        typename alloc_traits::template rebind_traits<block>;
+
+    block_alloc alloc_block = alloc;
+    block* new_block = nullptr;
+    try {
+      new_block = block_alloc_traits::allocate(alloc_block, 1);
+      block_alloc_traits::construct(alloc_block, new_block, ptr, deleter,
+                                    alloc);
+    } catch (...) {
+      if (new_block != nullptr) {
+        block_alloc_traits::deallocate(alloc_block, new_block, 1);
+      }
+      Deleter cleanup = deleter;
+      cleanup(ptr);
+      throw;
+    }
+    control_block_ = new_block;
+    ptr_ = ptr;
+    enable_shared_from_this(ptr, ptr);
+  }
+
+  // Points a newly owned object's EnableSharedFromThis base at its owner.
+  template <typename X, typename Y>
+  void enable_shared_from_this(const EnableSharedFromThis<X, Policy>* base,
+                               Y* ptr) {
+    if (base != nullptr && base->weak_this_.expired()) {
+      base->weak_this_ = SharedPtr<X, Policy>(
+          *this, const_cast<X*>(static_cast<const X*>(ptr)));
+    }
+  }
+  void enable_shared_from_this(...) {}
+
+  void release() {
+    if (control_block_ != nullptr) {
+      control_block_->release_shared();
+    }
+  }
+
  public:
   SharedPtr() : ptr_(nullptr) {}
   SharedPtr(std::nullptr_t) : ptr_(nullptr) {}
 
   template <typename Y>
   SharedPtr(Y* ptr) {
-    using alloc_traits = std::allocator_traits<std::allocator<T>>;
-    using block_alloc = typename alloc_traits::template rebind_alloc<
-        control_block::Base<T, std::default_delete<T>, std::allocator<T>>>;
-    using block_alloc_traits = typename alloc_traits::template rebind_traits<
-        control_block::Base<T, std::default_delete<T>, std::allocator<T>>>;
-
-    block_alloc alloc;
-    control_block_ = block_alloc_traits::allocate(alloc, 1);
-    block_alloc_traits::construct(
-        alloc, reinterpret_cast<control_block::Base<T>*>(control_block_), ptr);
-    ptr_ = static_cast<T*>(control_block_->object_ptr);
-    ++control_block_->count_shared;
-  }
-
-  ~SharedPtr() {
-    if (!ptr_) {
-      return;
-    }
-    if (control_block_->count_shared != 0) {
-      --control_block_->count_shared;
+    using deleter = std::conditional_t<std::is_array_v<T>,
+                                       std::default_delete<T>,
+                                       std::default_delete<Y>>;
+    create_block(ptr, deleter(), BlockPoolAllocator<char>());
+  }
+
+  ~SharedPtr() { release(); }
+
+  template <typename Y>
+  SharedPtr(const SharedPtr<Y, Policy>& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    if (control_block_ != nullptr) {
+      control_block_->add_shared();
     }
-    if (control_block_->count_shared == 0) {
-      control_block_->delete_ptr();
-      if (control_block_->count_weak == 0) {
-        control_block_->deallocate_block();
-      }
+  }
+
+  SharedPtr(const SharedPtr& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    if (control_block_ != nullptr) {
+      control_block_->add_shared();
     }
   }
 
-  template <typename Y>
-  SharedPtr(const SharedPtr<Y>& other)
-      : control_block_(other.control_block_), ptr_(other.ptr_) {
-    ++other.control_block_->count_shared;
+  SharedPtr(SharedPtr&& other) noexcept
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    other.control_block_ = nullptr;
+    other.ptr_ = nullptr;
   }
 
-  SharedPtr(const SharedPtr<T>& other)
-      : control_block_(other.control_block_), ptr_(other.ptr_) {
-    ++control_block_->count_shared;
+  // Shares ownership with other but points at ptr, typically a member or
+  // sub-object of what other owns. No allocation takes place.
+  template <typename Y>
+  SharedPtr(const SharedPtr<Y, Policy>& other, element_type* ptr)
+      : ptr_(ptr), control_block_(other.control_block_) {
+    if (control_block_ != nullptr) {
+      control_block_->add_shared();
+    }
   }
 
-  SharedPtr(SharedPtr<T>&& other)
-      : control_block_(std::move(other.control_block_)),
-        ptr_(std::move(other.ptr_)) {
+  template <typename Y>
+  SharedPtr(SharedPtr<Y, Policy>&& other, element_type* ptr) noexcept
+      : ptr_(ptr), control_block_(other.control_block_) {
     other.control_block_ = nullptr;
     other.ptr_ = nullptr;
   }
 
   template <typename Y>
-  SharedPtr<T>& operator=(const SharedPtr<Y>& other) {
-    std::cout << "operator=\n";
-    SharedPtr<T> dop(other);
+  SharedPtr& operator=(const SharedPtr<Y, Policy>& other) {
+    SharedPtr dop(other);
     std::swap(control_block_, dop.control_block_);
     std::swap(ptr_, dop.ptr_);
     return *this;
   }
 
-  SharedPtr<T>& operator=(const SharedPtr<T>& other) {
-    SharedPtr<T> dop(other);
+  SharedPtr& operator=(const SharedPtr& other) {
+    SharedPtr dop(other);
     std::swap(control_block_, dop.control_block_);
     std::swap(ptr_, dop.ptr_);
     return *this;
   }
 
-  SharedPtr<T>& operator=(SharedPtr<T>&& other) {
-    SharedPtr<T> dop(std::move(other));
+  SharedPtr& operator=(SharedPtr&& other) noexcept {
+    SharedPtr dop(std::move(other));
     std::swap(control_block_, dop.control_block_);
     std::swap(ptr_, dop.ptr_);
     return *this;
@@ -174,113 +434,310 @@ class SharedPtr {
 
   template <typename Y, typename Deleter>
   SharedPtr(Y* ptr, const Deleter& deleter) {
-    using alloc_traits = std::allocator_traits<std::allocator<T>>;
-    using block_alloc = typename alloc_traits::template rebind_alloc<
-        control_block::Base<T, Deleter, std::allocator<T>>>;
-    using block_alloc_traits = typename alloc_traits::template rebind_traits<
-        control_block::Base<T, Deleter, std::allocator<T>>>;
-
-    block_alloc alloc;
-    control_block_ = block_alloc_traits::allocate(alloc, 1);
-    block_alloc_traits::construct(
-        alloc,
-        reinterpret_cast<control_block::Base<T, Deleter>*>(control_block_), ptr,
-        deleter);
-    ptr_ = static_cast<T*>(control_block_->object_ptr);
-    ++control_block_->count_shared;
+    create_block(ptr, deleter, BlockPoolAllocator<char>());
   }
 
   template <typename Y, typename Deleter, typename Alloc>
   SharedPtr(Y* ptr, const Deleter& deleter, const Alloc& alloc) {
-    using alloc_traits = std::allocator_traits<Alloc>;
-    using block_alloc = typename alloc_traits::template rebind_alloc<
-        control_block::Base<T, Deleter, Alloc>>;
-    using block_alloc_traits = typename alloc_traits::template rebind_traits<
-        control_block::Base<T, Deleter, Alloc>>;
-
-    block_alloc alloc_block = alloc;
-    control_block_ = block_alloc_traits::allocate(alloc_block, 1);
-    block_alloc_traits::construct(
-        alloc_block,
-        reinterpret_cast<control_block::Base<T, Deleter, Alloc>*>(
-            control_block_),
-        ptr, deleter, alloc_block);
-    ptr_ = static_cast<T*>(control_block_->object_ptr);
-    ++control_block_->count_shared;
+    create_block(ptr, deleter, alloc);
   }
 
   size_t use_count() const {
-    if (!ptr_) {
+    if (control_block_ == nullptr) {
       return 0;
     }
-    return control_block_->count_shared;
+    return control_block_->use_count();
   }
 
-  T* get() const { return ptr_; }
+  element_type* get() const { return ptr_; }
 
-  T& operator*() const { return *ptr_; }
+  element_type& operator*() const { return *ptr_; }
 
-  T* operator->() const { return ptr_; }
+  element_type* operator->() const { return ptr_; }
+
+  element_type& operator[](std::ptrdiff_t index) const { return ptr_[index]; }
 
   void reset() {
-    if (!ptr_) {
-      return;
-    }
-    if (control_block_->count_shared != 0) {
-      --control_block_->count_shared;
-    }
-    if (control_block_->count_shared == 0) {
-      control_block_->delete_ptr();
-      if (control_block_->count_weak == 0) {
-        control_block_->deallocate_block();
-      }
-    }
+    release();
+    control_block_ = nullptr;
     ptr_ = nullptr;
   }
 };
 
-template <typename T>
+template <typename T, typename Policy>
 class WeakPtr {
  private:
-  T* ptr_;
-  control_block::Counter* control_block_;
+  using counter = control_block::Counter<Policy>;
+
+  std::remove_extent_t<T>* ptr_ = nullptr;
+  counter* control_block_ = nullptr;
+
+  template <typename U, typename OtherPolicy>
+  friend class WeakPtr;
+
+  void acquire() {
+    if (control_block_ != nullptr) {
+      control_block_->add_weak();
+    }
+  }
+
+  void release() {
+    if (control_block_ != nullptr) {
+      control_block_->release_weak();
+    }
+  }
 
  public:
-  WeakPtr(const SharedPtr<T>& ptr)
-      : control_block_(ptr.control_block_), ptr_(ptr.ptr_) {
-    ++control_block_->count_weak;
+  WeakPtr() = default;
+
+  template <typename Y>
+  WeakPtr(const SharedPtr<Y, Policy>& ptr)
+      : ptr_(ptr.ptr_), control_block_(ptr.control_block_) {
+    acquire();
+  }
+
+  WeakPtr(const WeakPtr& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    acquire();
+  }
+
+  template <typename Y>
+  WeakPtr(const WeakPtr<Y, Policy>& other)
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    acquire();
+  }
+
+  WeakPtr(WeakPtr&& other) noexcept
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    other.control_block_ = nullptr;
+    other.ptr_ = nullptr;
   }
 
-  ~WeakPtr() {
-    --control_block_->count_weak;
-    if ((control_block_->count_weak == 0) &&
-        (control_block_->count_shared == 0)) {
-      control_block_->deallocate_block();
+  template <typename Y>
+  WeakPtr(WeakPtr<Y, Policy>&& other) noexcept
+      : ptr_(other.ptr_), control_block_(other.control_block_) {
+    other.control_block_ = nullptr;
+    other.ptr_ = nullptr;
+  }
+
+  ~WeakPtr() { release(); }
+
+  template <typename Y>
+  WeakPtr& operator=(const SharedPtr<Y, Policy>& other) {
+    WeakPtr dop(other);
+    std::swap(control_block_, dop.control_block_);
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  WeakPtr& operator=(const WeakPtr& other) {
+    WeakPtr dop(other);
+    std::swap(control_block_, dop.control_block_);
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  template <typename Y>
+  WeakPtr& operator=(const WeakPtr<Y, Policy>& other) {
+    WeakPtr dop(other);
+    std::swap(control_block_, dop.control_block_);
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  WeakPtr& operator=(WeakPtr&& other) noexcept {
+    WeakPtr dop(std::move(other));
+    std::swap(control_block_, dop.control_block_);
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  template <typename Y>
+  WeakPtr& operator=(WeakPtr<Y, Policy>&& other) noexcept {
+    WeakPtr dop(std::move(other));
+    std::swap(control_block_, dop.control_block_);
+    std::swap(ptr_, dop.ptr_);
+    return *this;
+  }
+
+  size_t use_count() const {
+    if (control_block_ == nullptr) {
+      return 0;
     }
+    return control_block_->use_count();
   }
 
-  bool expired() const { return control_block_->count_shared == 0; }
+  bool expired() const { return use_count() == 0; }
+
+  SharedPtr<T, Policy> lock() const {
+    if (control_block_ == nullptr || !control_block_->try_add_shared()) {
+      return SharedPtr<T, Policy>();
+    }
+    return SharedPtr<T, Policy>(typename SharedPtr<T, Policy>::AdoptTag(),
+                                ptr_, control_block_);
+  }
+
+  void reset() {
+    release();
+    control_block_ = nullptr;
+    ptr_ = nullptr;
+  }
+};
+
+// Base for objects that need SharedPtrs to themselves. The first owner of
+// the object, be it MakeShared, AllocateShared or a raw-pointer constructor,
+// registers itself here; until then shared_from_this() is empty.
+template <typename T, typename Policy>
+class EnableSharedFromThis {
+ public:
+  SharedPtr<T, Policy> shared_from_this() { return weak_this_.lock(); }
+  SharedPtr<const T, Policy> shared_from_this() const {
+    return weak_this_.lock();
+  }
+
+  WeakPtr<T, Policy> weak_from_this() { return weak_this_; }
+  WeakPtr<const T, Policy> weak_from_this() const { return weak_this_; }
+
+ protected:
+  EnableSharedFromThis() = default;
+  // A copy is a different object with owners of its own.
+  EnableSharedFromThis(const EnableSharedFromThis&) {}
+  EnableSharedFromThis& operator=(const EnableSharedFromThis&) {
+    return *this;
+  }
+  ~EnableSharedFromThis() = default;
+
+ private:
+  template <typename U, typename OtherPolicy>
+  friend class SharedPtr;
 
-  SharedPtr<T> lock() const { return SharedPtr<T>(ptr_); }
+  mutable WeakPtr<T, Policy> weak_this_;
 };
 
-template <typename U, typename... Args>
-SharedPtr<U> MakeShared(Args&&... args) {
-  auto control_block = new control_block::Make<U>(std::forward<Args>(args)...);
-  return SharedPtr<U>(control_block);
+namespace control_block {
+// Builds SharedPtrs around freshly constructed Make and MakeArray blocks.
+struct Factory {
+  template <typename U, typename Policy, typename Alloc, typename... Args>
+  static SharedPtr<U, Policy> make_object(const Alloc& alloc,
+                                          Args&&... args) {
+    using block = Make<U, Alloc, Policy>;
+    using alloc_traits = std::allocator_traits<Alloc>;
+    using block_alloc = typename alloc_traits::template rebind_alloc<block>;
+    using block_alloc_traits =
+        typename alloc_traits::template rebind_traits<block>;
+
+    block_alloc alloc_new = alloc;
+    block* control_block = block_alloc_traits::allocate(alloc_new, 1);
+    try {
+      block_alloc_traits::construct(alloc_new, control_block, alloc,
+                                    std::forward<Args>(args)...);
+    } catch (...) {
+      block_alloc_traits::deallocate(alloc_new, control_block, 1);
+      throw;
+    }
+    SharedPtr<U, Policy> result(typename SharedPtr<U, Policy>::AdoptTag(),
+                                control_block->get(), control_block);
+    result.enable_shared_from_this(result.ptr_, result.ptr_);
+    return result;
+  }
+
+  // construct(object_alloc&, element*) builds one element in place.
+  template <typename U, typename Policy, typename Alloc, typename Construct>
+  static SharedPtr<U, Policy> make_array(const Alloc& alloc, size_t count,
+                                         Construct construct) {
+    using element = std::remove_extent_t<U>;
+    using block = MakeArray<element, Alloc, Policy>;
+
+    block* control_block = block::allocate(alloc, count);
+    typename block::object_alloc object_al = alloc;
+    element* data = control_block->data();
+    size_t constructed = 0;
+    try {
+      for (; constructed != count; ++constructed) {
+        construct(object_al, data + constructed);
+      }
+    } catch (...) {
+      control_block->destroy_elements(constructed);
+      control_block->deallocate();
+      throw;
+    }
+    return SharedPtr<U, Policy>(typename SharedPtr<U, Policy>::AdoptTag(),
+                                data, control_block);
+  }
+};
+};  // namespace control_block
+
+template <typename T>
+inline constexpr bool kIsUnboundedArray =
+    std::is_array_v<T> && std::extent_v<T> == 0;
+
+template <typename U, typename Policy = ref_count::ThreadSafe,
+          typename Alloc, typename... Args>
+std::enable_if_t<!std::is_array_v<U>, SharedPtr<U, Policy>> AllocateShared(
+    const Alloc& alloc, Args&&... args) {
+  return control_block::Factory::make_object<U, Policy>(
+      alloc, std::forward<Args>(args)...);
 }
 
-template <typename U, typename Alloc, typename... Args>
-SharedPtr<U> AllocateShared(const Alloc& alloc, Args&&... args) {
-  using alloc_traits = std::allocator_traits<Alloc>;
-  using block_alloc = typename alloc_traits::template rebind_alloc<
-      control_block::Make<U, Alloc>>;
-  using block_alloc_traits = typename alloc_traits::template rebind_traits<
-      control_block::Make<U, Alloc>>;
-
-  block_alloc alloc_new = alloc;
-  auto control_block = block_alloc_traits::allocate(alloc_new, 1);
-  block_alloc_traits::construct(alloc_new, control_block,
-                                std::forward<Args>(args)...);
-  return SharedPtr<U>(control_block);
-}
\ No newline at end of file
+template <typename U, typename Policy = ref_count::ThreadSafe,
+          typename... Args>
+std::enable_if_t<!std::is_array_v<U>, SharedPtr<U, Policy>> MakeShared(
+    Args&&... args) {
+  return AllocateShared<U, Policy>(std::allocator<U>(),
+                                   std::forward<Args>(args)...);
+}
+
+// Counts and count value-initialized elements in one allocation.
+template <typename U, typename Policy = ref_count::ThreadSafe,
+          typename Alloc>
+std::enable_if_t<kIsUnboundedArray<U>, SharedPtr<U, Policy>> AllocateShared(
+    const Alloc& alloc, size_t count) {
+  return control_block::Factory::make_array<U, Policy>(
+      alloc, count, [](auto& object_al, auto* element) {
+        using traits = std::allocator_traits<std::decay_t<decltype(object_al)>>;
+        traits::construct(object_al, element);
+      });
+}
+
+template <typename U, typename Policy = ref_count::ThreadSafe,
+          typename Alloc>
+std::enable_if_t<kIsUnboundedArray<U>, SharedPtr<U, Policy>> AllocateShared(
+    const Alloc& alloc, size_t count, const std::remove_extent_t<U>& init) {
+  return control_block::Factory::make_array<U, Policy>(
+      alloc, count, [&init](auto& object_al, auto* element) {
+        using traits = std::allocator_traits<std::decay_t<decltype(object_al)>>;
+        traits::construct(object_al, element, init);
+      });
+}
+
+// Elements are default-initialized: trivial types are left uninitialized.
+template <typename U, typename Policy = ref_count::ThreadSafe,
+          typename Alloc>
+std::enable_if_t<kIsUnboundedArray<U>, SharedPtr<U, Policy>>
+AllocateSharedForOverwrite(const Alloc& alloc, size_t count) {
+  return control_block::Factory::make_array<U, Policy>(
+      alloc, count, [](auto&, auto* element) {
+        ::new (static_cast<void*>(element)) std::remove_extent_t<U>;
+      });
+}
+
+template <typename U, typename Policy = ref_count::ThreadSafe>
+std::enable_if_t<kIsUnboundedArray<U>, SharedPtr<U, Policy>> MakeShared(
+    size_t count) {
+  return AllocateShared<U, Policy>(std::allocator<std::remove_extent_t<U>>(),
+                                   count);
+}
+
+template <typename U, typename Policy = ref_count::ThreadSafe>
+std::enable_if_t<kIsUnboundedArray<U>, SharedPtr<U, Policy>> MakeShared(
+    size_t count, const std::remove_extent_t<U>& init) {
+  return AllocateShared<U, Policy>(std::allocator<std::remove_extent_t<U>>(),
+                                   count, init);
+}
+
+template <typename U, typename Policy = ref_count::ThreadSafe>
+std::enable_if_t<kIsUnboundedArray<U>, SharedPtr<U, Policy>>
+MakeSharedForOverwrite(size_t count) {
+  return AllocateSharedForOverwrite<U, Policy>(
+      std::allocator<std::remove_extent_t<U>>(), count);
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "smart_pointers.hpp"
+
+// Concurrent map from keys to shared values that does not keep the values
+// alive: an entry lives exactly as long as some SharedPtr to its value, so
+// equal objects are interned while anybody uses them and evicted afterwards.
+//
+// Each value carries a deleter holding the key and a WeakPtr to the cache,
+// which erases the entry once the value is destroyed; the cache itself may
+// be destroyed before its values. Keys are spread over kShardCount
+// independently locked maps, and no user code runs under their locks.
+//
+//   WeakValueCache<std::string, const Font> fonts;
+//   SharedPtr<const Font> font = fonts.emplace(name, name, 12);
+template <typename K, typename T, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class WeakValueCache {
+ public:
+  static constexpr size_t kShardCount = 16;
+
+ private:
+  using Map = std::unordered_map<K, WeakPtr<T>, Hash, KeyEqual>;
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    Map entries;
+  };
+
+  class State {
+   public:
+    State(const Hash& hash, const KeyEqual& equal) : hash_(hash) {
+      for (Shard& shard : shards_) {
+        shard.entries = Map(0, hash, equal);
+      }
+    }
+
+    Shard& shard(const K& key) { return shards_[hash_(key) % kShardCount]; }
+    Shard& shard_at(size_t index) { return shards_[index]; }
+
+   private:
+    Hash hash_;
+    Shard shards_[kShardCount];
+  };
+
+  // Destroys the value, then drops its entry unless a new value has been
+  // stored under the key in the meantime.
+  class Evictor {
+   public:
+    Evictor(const SharedPtr<State>& state, const K& key)
+        : state_(state), key_(key) {}
+
+    void operator()(T* ptr) const {
+      delete ptr;
+      SharedPtr<State> state = state_.lock();
+      if (state.get() == nullptr) {
+        return;
+      }
+      Shard& shard = state->shard(key_);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto entry = shard.entries.find(key_);
+      if (entry != shard.entries.end() && entry->second.expired()) {
+        shard.entries.erase(entry);
+      }
+    }
+
+   private:
+    WeakPtr<State> state_;
+    K key_;
+  };
+
+ public:
+  explicit WeakValueCache(const Hash& hash = Hash(),
+                          const KeyEqual& equal = KeyEqual())
+      : state_(MakeShared<State>(hash, equal)) {}
+  WeakValueCache(const WeakValueCache&) = delete;
+  WeakValueCache& operator=(const WeakValueCache&) = delete;
+
+  // The live value stored under key, or an empty pointer.
+  SharedPtr<T> find(const K& key) const {
+    Shard& shard = state_->shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto entry = shard.entries.find(key);
+    if (entry == shard.entries.end()) {
+      return SharedPtr<T>();
+    }
+    return entry->second.lock();
+  }
+
+  // The live value stored under key; if there is none, the result of
+  // make() is stored. make() runs without any lock held, so callers racing
+  // on a missing key may each make a value, but all of them get back the
+  // one that was stored first.
+  template <typename Factory>
+  SharedPtr<T> get_or_create(const K& key, Factory make) {
+    return insert(key, [&]() { return new T(make()); });
+  }
+
+  // Like get_or_create(), constructing a missing value from args.
+  template <typename... Args>
+  SharedPtr<T> emplace(const K& key, Args&&... args) {
+    return insert(key, [&]() { return new T(std::forward<Args>(args)...); });
+  }
+
+  // Entries, including those whose values are being destroyed right now.
+  size_t size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < kShardCount; ++i) {
+      Shard& shard = state_->shard_at(i);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      total += shard.entries.size();
+    }
+    return total;
+  }
+
+ private:
+  template <typename Create>
+  SharedPtr<T> insert(const K& key, Create create) {
+    SharedPtr<T> value = find(key);
+    if (value.get() != nullptr) {
+      return value;
+    }
+    SharedPtr<T> created(create(), Evictor(state_, key));
+    {
+      Shard& shard = state_->shard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      WeakPtr<T>& entry = shard.entries[key];
+      value = entry.lock();
+      if (value.get() == nullptr) {
+        entry = created;
+        return created;
+      }
+    }
+    // The losing value is dropped outside the lock, since its deleter
+    // takes it again.
+    return value;
+  }
+
+  SharedPtr<State> state_;
+};
@@ -0,0 +1,122 @@
+// Hit rate and throughput of WeakValueCache for 1 to 64 threads that look
+// up Zipf-distributed keys through get_or_create(). Every thread keeps its
+// last few values alive in a ring, so popular keys stay cached while the
+// tail is evicted as soon as the last ring lets go of it.
+//
+//   g++ -std=c++17 -O2 -pthread weak_value_cache_bench.cpp -o bench
+//   ./bench [milliseconds per run]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "weak_value_cache.hpp"
+
+namespace {
+constexpr size_t kKeys = 100000;
+
+struct Page {
+  explicit Page(long key) : key(key) { std::fill_n(payload, 240, 'p'); }
+
+  long key;
+  char payload[240];
+};
+
+// Cumulative weights of a Zipf distribution with exponent 1 over kKeys keys.
+std::vector<double> zipf_table() {
+  std::vector<double> table(kKeys);
+  double sum = 0;
+  for (size_t i = 0; i < kKeys; ++i) {
+    sum += 1.0 / static_cast<double>(i + 1);
+    table[i] = sum;
+  }
+  for (double& weight : table) {
+    weight /= sum;
+  }
+  return table;
+}
+
+struct Result {
+  double mops;
+  double hit_rate;
+  size_t entries;
+};
+
+Result run(size_t threads, size_t held, const std::vector<double>& zipf,
+           std::chrono::milliseconds duration) {
+  WeakValueCache<long, Page> cache;
+  std::atomic<bool> start{false};
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> total{0};
+  std::atomic<size_t> misses{0};
+  std::atomic<size_t> wrong{0};
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::minstd_rand random(static_cast<unsigned>(t + 1));
+      std::uniform_real_distribution<double> uniform(0, 1);
+      std::vector<SharedPtr<Page>> ring(held);
+      size_t ops = 0;
+      size_t made = 0;
+      size_t mismatches = 0;
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      while (!stop.load(std::memory_order_relaxed)) {
+        double draw = uniform(random);
+        long key = std::lower_bound(zipf.begin(), zipf.end(), draw) -
+                   zipf.begin();
+        SharedPtr<Page> page = cache.get_or_create(key, [&] {
+          ++made;
+          return Page(key);
+        });
+        mismatches += page->key != key;
+        ring[ops % held] = page;
+        ++ops;
+      }
+      total.fetch_add(ops, std::memory_order_relaxed);
+      misses.fetch_add(made, std::memory_order_relaxed);
+      wrong.fetch_add(mismatches, std::memory_order_relaxed);
+    });
+  }
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(duration);
+  // Entries held by the rings; they are evicted once the workers exit.
+  size_t entries = cache.size();
+  stop.store(true, std::memory_order_relaxed);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - begin;
+  if (wrong.load() != 0) {
+    std::fprintf(stderr, "%zu lookups returned another key\n", wrong.load());
+  }
+  if (cache.size() != 0) {
+    std::fprintf(stderr, "%zu entries outlived their values\n", cache.size());
+  }
+  double lookups = static_cast<double>(total.load());
+  return {lookups / elapsed.count() / 1e6,
+          lookups == 0 ? 0 : 1 - static_cast<double>(misses.load()) / lookups,
+          entries};
+}
+};  // namespace
+
+int main(int argc, char** argv) {
+  std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+  std::vector<double> zipf = zipf_table();
+  std::printf("%8s %6s %10s %8s %8s\n", "threads", "held", "Mop/s", "hit %",
+              "entries");
+  for (size_t held : {16, 1024}) {
+    for (size_t threads = 1; threads <= 64; threads *= 2) {
+      Result result = run(threads, held, zipf, duration);
+      std::printf("%8zu %6zu %10.2f %8.1f %8zu\n", threads, held, result.mops,
+                  100 * result.hit_rate, result.entries);
+    }
+  }
+}